@@ -0,0 +1,43 @@
+// Heap allocation counter shared by quant-bench and the tests that check a path does not allocate (tools/nss).
+// It defines the replaceable allocation functions, so it is included by exactly one translation unit of a program.
+#pragma once
+#include <atomic>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+// Every replaceable operator new of the process goes through the counter. The whole set is replaced (plain, array, nothrow, aligned,
+// sized deletes) so that no allocation escapes the count and every delete matches the allocation function it frees
+static std::atomic<std::size_t> allocationCount{0};
+static void* allocate(std::size_t size, std::size_t alignment) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (alignment <= alignof(std::max_align_t)) return std::malloc(size ? size : 1);
+    // aligned_alloc requires a size multiple of the alignment
+    return std::aligned_alloc(alignment, ((size ? size : 1) + alignment - 1)/alignment*alignment);
+}
+// Kept out of line: once operator new and delete are inlined GCC pairs the malloc with free across them (-Wmismatched-new-delete)
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void deallocate(void* pointer) noexcept {std::free(pointer);}
+void* operator new(std::size_t size) {if (void* pointer = allocate(size, 0)) return pointer; throw std::bad_alloc();}
+void* operator new[](std::size_t size) {if (void* pointer = allocate(size, 0)) return pointer; throw std::bad_alloc();}
+void* operator new(std::size_t size, std::align_val_t alignment) {if (void* pointer = allocate(size, std::size_t(alignment))) return pointer; throw std::bad_alloc();}
+void* operator new[](std::size_t size, std::align_val_t alignment) {if (void* pointer = allocate(size, std::size_t(alignment))) return pointer; throw std::bad_alloc();}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {return allocate(size, 0);}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {return allocate(size, 0);}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {return allocate(size, std::size_t(alignment));}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {return allocate(size, std::size_t(alignment));}
+void operator delete(void* pointer) noexcept {deallocate(pointer);}
+void operator delete[](void* pointer) noexcept {deallocate(pointer);}
+void operator delete(void* pointer, std::size_t) noexcept {deallocate(pointer);}
+void operator delete[](void* pointer, std::size_t) noexcept {deallocate(pointer);}
+void operator delete(void* pointer, std::align_val_t) noexcept {deallocate(pointer);}
+void operator delete[](void* pointer, std::align_val_t) noexcept {deallocate(pointer);}
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {deallocate(pointer);}
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {deallocate(pointer);}
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {deallocate(pointer);}
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {deallocate(pointer);}
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {deallocate(pointer);}
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {deallocate(pointer);}
@@ -0,0 +1,397 @@
+// Micro-benchmarks of the hot paths of cpp-quant
+// Usage: quant-bench [--filter text] [--runs n] [--output file] [--baseline file] [--threshold ratio] [--write-baseline file]
+// Every benchmark is run --runs times (after one warm-up run, at most ~2s per benchmark), each run times a batch of operations.
+// Results are written as JSON (stdout by default): mean ns/op, p50/p90/p99 of the per-run ns/op and heap allocations per operation.
+// With --baseline the p50 of every benchmark is compared to the stored one, the exit code is 1 when one of them is slower than
+// threshold*baseline (default 1.25). Benchmarks missing from the baseline are reported and not checked.
+// The stored baseline is benchmarks/baseline.json, it is machine dependent: refresh it with --write-baseline on the reference machine.
+// Its "note" records where it was measured (--write-baseline does not write one, lines without a name are ignored when reading).
+// An option without a value is an error (exit code 2).
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstddef>
+#include <functional>
+#include <algorithm>
+#include <new>
+#include "../include/cpp-quant/tools/black.hpp"
+#include "../include/cpp-quant/tools/nss.hpp"
+#include "../include/cpp-quant/tools/scheduler.hpp"
+#include "../include/cpp-quant/valuation/marketdata/termstructures/discountcurve.hpp"
+#include "allocationcounter.hpp"
+
+// Results are accumulated here so that the optimizer keeps the benchmarked calls
+static volatile double sink = 0.0;
+
+struct Benchmark
+{
+    std::string name_;
+    // Operations performed by one call of run_
+    std::size_t operations_;
+    std::function<void()> run_;
+};
+
+struct Measurement
+{
+    std::string name_;
+    std::size_t runs_;
+    double nsPerOperation_, p50_, p90_, p99_, allocationsPerOperation_;
+};
+
+Measurement measure(const Benchmark& benchmark, std::size_t runs)
+{
+    benchmark.run_();
+    std::vector<double> samples;
+    samples.reserve(runs);
+    const std::size_t firstAllocation = allocationCount.load();
+    const auto budgetStart = std::chrono::steady_clock::now();
+    while (samples.size() < runs)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        benchmark.run_();
+        const auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count()/benchmark.operations_);
+        if (samples.size() >= 5 and std::chrono::duration<double>(end - budgetStart).count() > 2.0) break;
+    }
+    const double allocations = double(allocationCount.load() - firstAllocation);
+
+    Measurement measurement;
+    measurement.name_ = benchmark.name_;
+    measurement.runs_ = samples.size();
+    double sum = 0.0;
+    for (double sample: samples) sum += sample;
+    measurement.nsPerOperation_ = sum/samples.size();
+    std::sort(samples.begin(), samples.end());
+    auto getPercentile = [&samples](double p) {return samples[std::min(samples.size() - 1, std::size_t(p*samples.size()))];};
+    measurement.p50_ = getPercentile(.5);
+    measurement.p90_ = getPercentile(.9);
+    measurement.p99_ = getPercentile(.99);
+    measurement.allocationsPerOperation_ = allocations/(double(measurement.runs_)*benchmark.operations_);
+    return measurement;
+}
+
+// One benchmark per line so that a baseline can be read back without a JSON library
+std::string toJson(const std::vector<Measurement>& measurements)
+{
+    std::ostringstream json;
+    json << "{\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < measurements.size(); ++i)
+    {
+        const Measurement& m = measurements[i];
+        json << "    {\"name\": \"" << m.name_ << "\", \"runs\": " << m.runs_ << ", \"ns_per_op\": " << m.nsPerOperation_ << ", \"p50\": " << m.p50_
+             << ", \"p90\": " << m.p90_ << ", \"p99\": " << m.p99_ << ", \"allocs_per_op\": " << m.allocationsPerOperation_ << "}"
+             << (i + 1 < measurements.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+// p50 per benchmark name from a file written by toJson
+std::map<std::string, double> readBaseline(const std::string& path)
+{
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const std::size_t name = line.find("\"name\": \""), p50 = line.find("\"p50\": ");
+        if (name == std::string::npos or p50 == std::string::npos) continue;
+        const std::size_t nameStart = name + 9;
+        baseline[line.substr(nameStart, line.find('"', nameStart) - nameStart)] = std::atof(line.c_str() + p50 + 7);
+    }
+    return baseline;
+}
+
+// Zero yields data of Bank of Canada as of September 24th, 2025 (same data as tests/tools/nss)
+std::map<double, double> getCanadianZeroYieldData()
+{
+    const std::vector<double> rawData = {
+        0.0242277,0.0240667,0.0239455,0.0239879,0.0242138,0.0242958,0.0244047,0.0245381,0.0246938,0.0248696,0.0250637,0.0252740,
+        0.0254988,0.0257363,0.0259849,0.0262429,0.0265089,0.0267814,0.0270591,0.0273407,0.0276251,0.0279111,0.0281979,0.0284843,
+        0.0287696,0.0290529,0.0293336,0.0296110,0.0298844,0.0301535,0.0304176,0.0306763,0.0309294,0.0311764,0.0314171,0.0316513,
+        0.0318788,0.0320994,0.0323131,0.0325197,0.0327192,0.0329116,0.0330970,0.0332752,0.0334465,0.0336109,0.0337684,0.0339193,
+        0.0340636,0.0342015,0.0343332,0.0344587,0.0345784,0.0346924,0.0348009,0.0349041,0.0350022,0.0350955,0.0351840,0.0352681,
+        0.0353480,0.0354238,0.0354958,0.0355642,0.0356293,0.0356911,0.0357499,0.0358059,0.0358593,0.0359103,0.0359590,0.0360057,
+        0.0360504,0.0360934,0.0361347,0.0361746,0.0362132,0.0362506,0.0362869,0.0363222,0.0363567,0.0363904,0.0364235,0.0364560,
+        0.0364880,0.0365196,0.0365508,0.0365818,0.0366124,0.0366429,0.0366732,0.0367033,0.0367334,0.0367633,0.0367932,0.0368230,
+        0.0368527,0.0368823,0.0369119,0.0369414,0.0369708,0.0370000,0.0370291,0.0370580,0.0370868,0.0371152,0.0371434,0.0371713,
+        0.0371988,0.0372260,0.0372526,0.0372787,0.0373043,0.0373293,0.0373535,0.0373771,0.0373998,0.0374217,0.0374427,0.0374627};
+    std::map<double, double> data;
+    double t = 0;
+    for (const double y: rawData) {t += .25; data[t] = y;}
+    return data;
+}
+
+// (h, t) points of one pricing region of UndiscountedBlack::getCallPrice, h = x/s <= 0 and t = s/2
+std::vector<std::pair<double, double>> getRegionPoints(int region, std::size_t n)
+{
+    std::vector<std::pair<double, double>> points;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double u = (i + .5)/n, v = double((i*7919) % n)/n;
+        switch (region)
+        {
+            case 1: points.push_back({-30.0 + 19.0*u, .01 + .19*v}); break;
+            case 2: points.push_back({-9.0*u, .01 + .19*v}); break;
+            case 3: {const double h = -2.0*u; points.push_back({h, .86 - h + 2.0*v}); break;}
+            default: {const double h = -1.0 - 7.0*u; points.push_back({h, .21 + (.84 - h - .21)*v}); break;}
+        }
+    }
+    return points;
+}
+
+std::vector<Benchmark> getBenchmarks()
+{
+    std::vector<Benchmark> benchmarks;
+
+    // Black regions and the batch path
+    constexpr std::size_t regionPoints = 4096;
+    for (int region = 1; region <= 4; ++region)
+    {
+        auto points = std::make_shared<std::vector<std::pair<double, double>>>(getRegionPoints(region, regionPoints));
+        std::function<double(double, double)> kernel = region == 1 ? UndiscountedBlack::getCallPriceRegion1 : region == 2 ? UndiscountedBlack::getCallPriceRegion2
+            : region == 3 ? UndiscountedBlack::getCallPriceRegion3 : UndiscountedBlack::getCallPriceRegion4;
+        benchmarks.push_back({"black/region" + std::to_string(region), regionPoints, [points, kernel]() {
+            double sum = 0.0;
+            for (const auto& [h, t]: *points) sum += kernel(h, t);
+            sink = sink + sum;
+        }});
+    }
+    {
+        auto x = std::make_shared<std::vector<double>>(), s = std::make_shared<std::vector<double>>(), prices = std::make_shared<std::vector<double>>(regionPoints);
+        auto isCall = std::shared_ptr<bool[]>(new bool[regionPoints]);
+        for (std::size_t i = 0; i < regionPoints; ++i)
+        {
+            x->push_back(-3.0 + 6.0*(i + .5)/regionPoints);
+            s->push_back(.01 + 2.0*double((i*7919) % regionPoints)/regionPoints);
+            isCall[i] = i % 2 == 0;
+        }
+        benchmarks.push_back({"black/getPrice", regionPoints, [x, s, isCall]() {
+            double sum = 0.0;
+            for (std::size_t i = 0; i < x->size(); ++i) sum += UndiscountedBlack::getPrice((*x)[i], (*s)[i], isCall[i]);
+            sink = sink + sum;
+        }});
+        benchmarks.push_back({"black/getPrices", regionPoints, [x, s, isCall, prices]() {
+            UndiscountedBlack::getPrices(x->data(), s->data(), isCall.get(), x->size(), prices->data());
+            sink = sink + (*prices)[0];
+        }});
+    }
+
+    // Implied volatility over the (K, T, sigma) ranges of testBlackImpliedVolatilitySolver2 with a coarser step
+    {
+        struct Quote {double price_, F_, K_, T_;};
+        auto quotes = std::make_shared<std::vector<Quote>>();
+        const double S = 100.0, r = .01, q = .02;
+        for (double K = 1; K <= 500; K += 50)
+            for (double T = .001; T <= 30; T += 3.0)
+                for (double s = .01; s <= 5; s += .5)
+                {
+                    const double F = S*exp((r - q)*T);
+                    quotes->push_back({sqrt(F*K)*UndiscountedBlack::getPrice(log(F/K), s*sqrt(T), true), F, K, T});
+                }
+        benchmarks.push_back({"impliedvolatility/getBlackImpliedVolatility", quotes->size(), [quotes]() {
+            double sum = 0.0;
+            for (const Quote& quote: *quotes) sum += ImpliedVolatilitySolver::getBlackImpliedVolatility(quote.price_, quote.F_, quote.K_, quote.T_, true);
+            sink = sink + sum;
+        }});
+    }
+
+    // Heston Lewis prices on a 31-strike chain (parameters of testHestonLewisPrices)
+    {
+        auto plan = std::make_shared<BlackTools::LewisQuadraturePlan>(64);
+        auto adaptive = std::make_shared<BlackTools::AdaptiveLewisQuadrature>(1e-8);
+        auto x = std::make_shared<std::vector<double>>();
+        const double F = 100.0*exp(.04*1.5), T = 1.5;
+        for (double K = 50; K <= 200; K += 5) x->push_back(log(F/K));
+        const Heston::Parameters heston(2.0, .05, .3, .45, .05);
+        benchmarks.push_back({"heston/getUndiscountedLewisPrice", x->size(), [plan, x, heston, T]() {
+            double sum = 0.0;
+            for (double xi: *x) sum += Heston::getUndiscountedLewisPrice(xi, T, heston, true, *plan);
+            sink = sink + sum;
+        }});
+        benchmarks.push_back({"heston/adaptiveLewis1e-8", x->size(), [adaptive, x, heston, T]() {
+            auto characteristicFunction = [&heston, T](std::complex<double> u) {return Heston::getCharacteristicFunction(u, T, heston);};
+            double sum = 0.0;
+            for (double xi: *x) sum += adaptive->getUndiscountedPrice(xi, true, characteristicFunction).price_;
+            sink = sink + sum;
+        }});
+        // Strike-grid engines, one operation is one strike of the chain (comparable with heston/getUndiscountedLewisPrice)
+        auto cos = std::make_shared<BlackTools::COSEngine>(128);
+        auto carrMadan = std::make_shared<BlackTools::CarrMadanEngine>(4096);
+        benchmarks.push_back({"heston/cos128", x->size(), [cos, x, heston, T]() {
+            auto characteristicFunction = [&heston, T](std::complex<double> u) {return Heston::getCharacteristicFunction(u, T, heston);};
+            sink = sink + cos->getUndiscountedPrices(*x, true, characteristicFunction)[0];
+        }});
+        benchmarks.push_back({"heston/carrMadan4096", x->size(), [carrMadan, x, heston, T]() {
+            auto characteristicFunction = [&heston, T](std::complex<double> u) {return Heston::getCharacteristicFunction(u, T, heston);};
+            sink = sink + carrMadan->getUndiscountedPrices(*x, true, characteristicFunction)[0];
+        }});
+    }
+
+    // Nelson-Siegel-Svensson calibration and discount curves on the Canadian zero curve
+    {
+        auto data = std::make_shared<std::map<double, double>>(getCanadianZeroYieldData());
+        benchmarks.push_back({"nss/fitSvensson", 1, [data]() {
+            NelsonSiegelCalibration calibration(*data, true);
+            sink = sink + calibration.fitSvensson()->getRate(10.0);
+        }});
+        benchmarks.push_back({"nss/fitSvenssonVariableProjection", 1, [data]() {
+            NelsonSiegelCalibration calibration(*data, true);
+            calibration.setCalibrationMethod(NelsonSiegelCalibration::CalibrationMethod::VARIABLE_PROJECTION);
+            sink = sink + calibration.fitSvensson()->getRate(10.0);
+        }});
+        // Intraday recalibration on quotes moving by a basis point, after a first full calibration
+        auto session = std::make_shared<NelsonSiegelCalibrationSession>(true, true);
+        session->update(*data);
+        auto shiftedData = std::make_shared<std::map<double, double>>(*data);
+        for (auto& d: *shiftedData) d.second += 1e-4;
+        benchmarks.push_back({"nss/sessionUpdate", 2, [session, data, shiftedData]() {
+            sink = sink + session->update(*shiftedData).beta0_ + session->update(*data).beta0_;
+        }});
+        // Backfill: 64 shifted copies of the curve on the same maturities, per curve cost
+        std::vector<double> maturities;
+        for (const auto& d: *data) maturities.push_back(d.first);
+        auto batch = std::make_shared<NelsonSiegelBatchCalibration>(maturities, true, true);
+        auto history = std::make_shared<std::vector<double>>();
+        for (int c = 0; c < 64; ++c) for (const auto& d: *data) history->push_back(d.second + 1e-4*c*d.first/30.0);
+        benchmarks.push_back({"nss/batchSvensson", 64, [batch, history]() {
+            sink = sink + batch->fit(history->data(), 64)[63].beta0_;
+        }});
+        benchmarks.push_back({"nss/singleSvenssonVariableProjection", 64, [data, history]() {
+            std::map<double, double> curve;
+            double sum = 0.0;
+            for (std::size_t c = 0; c < 64; ++c)
+            {
+                std::size_t k = 0;
+                for (const auto& d: *data) curve[d.first] = (*history)[c*data->size() + k++];
+                NelsonSiegelCalibration calibration(curve, true);
+                calibration.setCalibrationMethod(NelsonSiegelCalibration::CalibrationMethod::VARIABLE_PROJECTION);
+                sum += calibration.fitSvensson()->getRate(10.0);
+            }
+            sink = sink + sum;
+        }});
+        auto calibration = std::make_shared<NelsonSiegelCalibration>(*data, true);
+        benchmarks.push_back({"nss/getFit", 100, [calibration]() {
+            double sum = 0.0;
+            for (int k = 0; k < 100; ++k) sum += calibration->getFit(1.0 + .05*k, 12.0, true).meanSquaredError_;
+            sink = sink + sum;
+        }});
+        const DateTime referenceTime(1758704936, EpochTimestampType::SECONDS);
+        benchmarks.push_back({"discountcurve/construct", 1, [data, referenceTime]() {
+            DiscountCurve curve(referenceTime, *data, DiscountCurve::InterpolationMethod::CUBIC_SPLINE, DiscountCurve::InterpolationVariable::ZC_SIMPLE_YIELD);
+            sink = sink + curve.getValue(1.0);
+        }});
+        auto curve = std::make_shared<DiscountCurve>(referenceTime, *data, DiscountCurve::InterpolationMethod::CUBIC_SPLINE, DiscountCurve::InterpolationVariable::ZC_SIMPLE_YIELD);
+        benchmarks.push_back({"discountcurve/getValue", 1000, [curve]() {
+            double sum = 0.0;
+            for (int i = 1; i <= 1000; ++i) sum += curve->getValue(.03*i);
+            sink = sink + sum;
+        }});
+        auto grid = std::make_shared<std::vector<double>>();
+        // Half of the grid beyond the 30Y pillar, extrapolated with the Svensson fit
+        for (int i = 1; i <= 1000; ++i) grid->push_back(.06*i);
+        benchmarks.push_back({"discountcurve/getValueGrid", 1000, [curve, grid]() {
+            double sum = 0.0;
+            for (double t: *grid) sum += curve->getValue(t);
+            sink = sink + sum;
+        }});
+        benchmarks.push_back({"discountcurve/getValues", 1000, [curve, grid]() {
+            sink = sink + curve->getValues(*grid)[999];
+        }});
+        // Curve of the variable projection fit, so that the evaluation benchmarks do not depend on the cpp-math optimizer
+        NelsonSiegelCalibration svenssonCalibration(*data, true);
+        svenssonCalibration.setCalibrationMethod(NelsonSiegelCalibration::CalibrationMethod::VARIABLE_PROJECTION);
+        auto svensson = svenssonCalibration.fitSvensson();
+        benchmarks.push_back({"nss/getRate", 1000, [svensson, grid]() {
+            double sum = 0.0;
+            for (double t: *grid) sum += svensson->getRate(t) + svensson->getInstantaneousForwardRate(t);
+            sink = sink + sum;
+        }});
+        auto outputs = std::make_shared<std::vector<double>>(2*grid->size());
+        benchmarks.push_back({"nss/evaluate", 1000, [svensson, grid, outputs]() {
+            svensson->evaluate(grid->data(), grid->size(), outputs->data(), outputs->data() + grid->size(), nullptr);
+            sink = sink + (*outputs)[999] + (*outputs)[1999];
+        }});
+        benchmarks.push_back({"discountcurve/getContinuousForwardRate", 1000, [curve]() {
+            double sum = 0.0;
+            for (int i = 1; i <= 1000; ++i) sum += curve->getContinuousForwardRate(.029*i, .029*i + .25);
+            sink = sink + sum;
+        }});
+    }
+
+    // Scheduler day counts and schedules
+    {
+        const DateTime referenceTime(1756155600, EpochTimestampType::SECONDS);
+        auto dates = std::make_shared<std::vector<DateTime>>();
+        for (int i = 1; i <= 1000; ++i) dates->push_back(referenceTime + TimeDelta(7*i, 0, 0, 0, 0, 0, 0));
+        for (const auto& [name, convention]: std::vector<std::pair<std::string, DayCountConvention>>{
+            {"ACTUAL_365", DayCountConvention::ACTUAL_365}, {"ACTUAL_ACTUAL", DayCountConvention::ACTUAL_ACTUAL}, {"E30_360", DayCountConvention::E30_360}})
+        {
+            auto scheduler = std::make_shared<Scheduler>(convention, BusinessDayConvention::MODIFIED_FOLLOWING, HolidayCalendar::NONE);
+            benchmarks.push_back({"scheduler/getYearFraction/" + name, dates->size(), [scheduler, dates, referenceTime]() {
+                double sum = 0.0;
+                for (const DateTime& date: *dates) sum += scheduler->getYearFraction(referenceTime, date);
+                sink = sink + sum;
+            }});
+        }
+        auto scheduler = std::make_shared<Scheduler>(DayCountConvention::ACTUAL_360, BusinessDayConvention::MODIFIED_FOLLOWING, HolidayCalendar::NONE);
+        benchmarks.push_back({"scheduler/getSchedule", 1, [scheduler, referenceTime]() {
+            sink = sink + double(scheduler->getSchedule(referenceTime, Tenor(3, TenorType::MONTHS), 120).size());
+        }});
+    }
+    return benchmarks;
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter, output, baselinePath, writeBaselinePath;
+    std::size_t runs = 30;
+    double threshold = 1.25;
+    for (int i = 1; i < argc; i += 2)
+    {
+        const std::string option = argv[i];
+        if (i + 1 == argc) {std::cerr << "Missing value for option " << option << std::endl; return 2;}
+        const std::string value = argv[i+1];
+        if (option == "--filter") filter = value;
+        else if (option == "--runs") runs = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--output") output = value;
+        else if (option == "--baseline") baselinePath = value;
+        else if (option == "--threshold") threshold = std::atof(value.c_str());
+        else if (option == "--write-baseline") writeBaselinePath = value;
+        else {std::cerr << "Unknown option " << option << std::endl; return 2;}
+    }
+
+    std::vector<Measurement> measurements;
+    for (const Benchmark& benchmark: getBenchmarks())
+    {
+        if (!filter.empty() and benchmark.name_.find(filter) == std::string::npos) continue;
+        measurements.push_back(measure(benchmark, runs));
+        const Measurement& m = measurements.back();
+        std::cerr << m.name_ << ": " << m.p50_ << " ns/op (p90 " << m.p90_ << ", " << m.allocationsPerOperation_ << " allocs/op)" << std::endl;
+    }
+
+    const std::string json = toJson(measurements);
+    if (output.empty()) std::cout << json;
+    else std::ofstream(output) << json;
+    if (!writeBaselinePath.empty()) std::ofstream(writeBaselinePath) << json;
+
+    if (baselinePath.empty()) return 0;
+    const std::map<std::string, double> baseline = readBaseline(baselinePath);
+    if (baseline.empty()) {std::cerr << "Baseline " << baselinePath << " is empty or missing" << std::endl; return 2;}
+    int regressions = 0;
+    for (const Measurement& m: measurements)
+    {
+        auto it = baseline.find(m.name_);
+        if (it == baseline.end()) {std::cerr << "[no baseline] " << m.name_ << std::endl; continue;}
+        const double ratio = m.p50_/it->second;
+        if (ratio > threshold) {++regressions; std::cerr << "[regression] " << m.name_ << ": " << m.p50_ << " ns/op vs " << it->second << " (x" << ratio << ")" << std::endl;}
+    }
+    std::cerr << regressions << " regression(s) over x" << threshold << " of " << baselinePath << std::endl;
+    return regressions > 0 ? 1 : 0;
+}
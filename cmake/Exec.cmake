@@ -1,15 +1,43 @@
 add_executable(quant-tools-black ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/black.cpp)
 target_link_libraries(quant-tools-black PUBLIC cpp-quant)
 
+add_executable(quant-tools-finitedifference ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/finitedifference.cpp)
+target_link_libraries(quant-tools-finitedifference PUBLIC cpp-quant)
+
+add_executable(quant-tools-metrics ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/metrics.cpp)
+target_link_libraries(quant-tools-metrics PUBLIC cpp-quant)
+
+add_executable(quant-tools-mixedprecision ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/mixedprecision.cpp)
+target_link_libraries(quant-tools-mixedprecision PUBLIC cpp-quant)
+
+add_executable(quant-tools-montecarlo ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/montecarlo.cpp)
+target_link_libraries(quant-tools-montecarlo PUBLIC cpp-quant)
+
+add_executable(quant-tools-normal ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/normal.cpp)
+target_link_libraries(quant-tools-normal PUBLIC cpp-quant)
+
 add_executable(quant-tools-nss ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/nss/nss.cpp)
 target_link_libraries(quant-tools-nss PUBLIC cpp-quant)
 
+add_executable(quant-tools-optionchain ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/optionchain.cpp)
+target_link_libraries(quant-tools-optionchain PUBLIC cpp-quant)
+
 add_executable(quant-tools-scheduler ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/scheduler.cpp)
 target_link_libraries(quant-tools-scheduler PUBLIC cpp-quant)
 
+add_executable(quant-tools-threadpool ${CMAKE_CURRENT_SOURCE_DIR}/tests/tools/threadpool.cpp)
+target_link_libraries(quant-tools-threadpool PUBLIC cpp-quant)
+
 add_executable(quant-valuation-termstructures-discountcurve ${CMAKE_CURRENT_SOURCE_DIR}/tests/valuation/marketdata/termstructures/discountcurve/discountcurve.cpp)
 target_link_libraries(quant-valuation-termstructures-discountcurve PUBLIC cpp-quant)
 
+add_executable(quant-valuation-volatility-volatilitysurface ${CMAKE_CURRENT_SOURCE_DIR}/tests/valuation/marketdata/volatility/volatilitysurface.cpp)
+target_link_libraries(quant-valuation-volatility-volatilitysurface PUBLIC cpp-quant)
+
+# Micro-benchmarks (JSON report, regression check against benchmarks/baseline.json)
+add_executable(quant-bench ${CMAKE_CURRENT_SOURCE_DIR}/benchmarks/bench.cpp)
+target_link_libraries(quant-bench PUBLIC cpp-quant)
+
 # Scheduler tool tests
 #add_executable(quant-test2 ${CMAKE_CURRENT_SOURCE_DIR}/tests/test2.cpp)
 #target_link_libraries(quant-test2 PUBLIC cpp-quant)
@@ -4,9 +4,39 @@ add_library(
         src/errors.cpp
         src/tools/nss.cpp
         src/tools/black.cpp
+        src/tools/finitedifference.cpp
+        src/tools/metrics.cpp
+        src/tools/mixedprecision.cpp
+        src/tools/montecarlo.cpp
+        src/tools/normal.cpp
+        src/tools/optionchain.cpp
         src/tools/scheduler.cpp
+        src/tools/threadpool.cpp
         src/valuation/marketdata/marketdata.cpp
-        src/valuation/marketdata/termstructures/discountcurve.cpp)
+        src/valuation/marketdata/termstructures/discountcurve.cpp
+        src/valuation/marketdata/volatility/volatilitysurface.cpp)
 target_link_libraries(cpp-quant  PUBLIC cpp-datetime)
 target_link_libraries(cpp-quant  PUBLIC cpp-math)
+find_package(Threads REQUIRED)
+target_link_libraries(cpp-quant  PUBLIC Threads::Threads)
 target_include_directories(cpp-quant  PUBLIC include)
+
+# Batch kernels are written as SIMD-friendly loops (#pragma omp simd), CPP_QUANT_ENABLE_SIMD compiles them for the host lanes (AVX2/AVX-512)
+option(CPP_QUANT_ENABLE_SIMD "Compile cpp-quant for the SIMD extensions of the host" OFF)
+# Translation units holding branch-free SIMD kernels (see tools/vectormath.hpp). Without -fno-trapping-math GCC keeps every floating
+# point select (clamp, region mask) as a branch, and without -fno-math-errno every sqrt as a guarded libm call: both loops stay scalar.
+# The library never reads the floating point exception flags nor errno, results are unchanged (same operations, no reassociation).
+set(CPP_QUANT_SIMD_SOURCES src/tools/nss.cpp src/tools/black.cpp src/tools/normal.cpp src/tools/montecarlo.cpp src/tools/mixedprecision.cpp)
+if (CMAKE_CXX_COMPILER_ID MATCHES "GNU|Clang")
+    target_compile_options(cpp-quant PRIVATE -fopenmp-simd)
+    set_source_files_properties(${CPP_QUANT_SIMD_SOURCES} PROPERTIES COMPILE_OPTIONS "-fno-trapping-math;-fno-math-errno")
+    if (CPP_QUANT_ENABLE_SIMD)
+        target_compile_options(cpp-quant PRIVATE -march=native)
+    endif()
+endif()
+
+# Hot-path counters and histograms (see tools/metrics.hpp), the instrumentation compiles to nothing when OFF
+option(CPP_QUANT_ENABLE_METRICS "Instrument cpp-quant solvers and calibrations with the metrics registry" OFF)
+if (CPP_QUANT_ENABLE_METRICS)
+    target_compile_definitions(cpp-quant PUBLIC CPP_QUANT_METRICS)
+endif()
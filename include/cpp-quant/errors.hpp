@@ -33,6 +33,13 @@ namespace QuantErrorRegistry
                 }
             }
 
+            namespace VolatilitySurface
+            {
+                class EmptyVolatilityQuotesError final:public QuantLibraryError {protected: std::string getErrorMessage() const override; };
+                class InvalidVolatilityQuoteError final:public QuantLibraryError {protected: std::string getErrorMessage() const override; };
+                class InsufficientSliceQuotesError final:public QuantLibraryError {protected: std::string getErrorMessage() const override; };
+            }
+
         }
     }
 
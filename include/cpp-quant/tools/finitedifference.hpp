@@ -0,0 +1,116 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include "black.hpp"
+
+// Finite-difference engines for Black-Scholes (Crank-Nicolson) and Heston (Hundsdorfer-Verwer ADI) with European, American and Bermudan exercise
+// References
+// Penalty methods for American options with stochastic volatility - Forsyth and Vetzal (2002) : https://doi.org/10.1016/S0377-0427(01)00393-1
+// ADI finite difference schemes for option pricing in the Heston model with correlation - In 't Hout and Foulon (2010) : https://arxiv.org/abs/0811.3427
+// A grid is built once per (spot, maturity, model) and every strike of a chain is priced in the same time loop: the values of all strikes
+// are stored side by side at each node so that the tridiagonal solves sweep the nodes once and vectorize over the strikes.
+// Prices are discounted premiums in spot, rate and dividend yield (exercise is on the spot), Greeks are read from the grid at the spot.
+
+namespace FiniteDifference
+{
+    enum class Exercise {EUROPEAN, AMERICAN, BERMUDAN};
+    // Resolution of the American linear complementarity problem at each Crank-Nicolson step
+    enum class ExerciseMethod {PSOR, PENALTY};
+
+    // Tridiagonal matrix shared by many right-hand sides: row i of the right-hand sides holds width values at rhs + i*stride
+    class TridiagonalSystem
+    {
+        public:
+            TridiagonalSystem(const std::vector<double>& lower, const std::vector<double>& diagonal, const std::vector<double>& upper);
+            TridiagonalSystem() = default;
+            ~TridiagonalSystem() = default;
+
+            std::size_t getSize() const;
+            // Thomas algorithm with the factorization computed once
+            void solve(double* rhs, std::size_t stride, std::size_t width) const;
+            // Same matrix plus a diagonal per right-hand side (shift[i*width + k]), the factorization is done on the fly
+            void solve(double* rhs, std::size_t stride, std::size_t width, const double* shift, double* workspace) const;
+
+        private:
+            std::vector<double> lower_;
+            std::vector<double> diagonal_;
+            std::vector<double> upper_;
+            // Thomas factorization: modified upper diagonal and inverse pivots
+            std::vector<double> factorizedUpper_;
+            std::vector<double> inversePivots_;
+    };
+
+    // Greeks at the spot: delta and gamma in spot, theta = -dV/dT (time to maturity)
+    struct Greeks
+    {
+        double price_, delta_, gamma_, theta_;
+    };
+
+    class BlackGrid
+    {
+        public:
+            // Uniform log-spot grid centered on the spot over +/- 6 standard deviations, the spot is a node
+            BlackGrid(double S, double T, double r, double q, double sigma, std::size_t nodes, std::size_t timeSteps);
+            ~BlackGrid() = default;
+
+            void setExerciseMethod(const ExerciseMethod& exerciseMethod);
+            std::size_t getNodes() const;
+            std::size_t getTimeSteps() const;
+            const std::vector<double>& getLogSpots() const;
+            // Projected SOR sweeps or penalty iterations of the last American run
+            std::size_t getIterations() const;
+
+            // All strikes in one backward induction, Bermudan exercise times are in years from today (snapped to the time grid)
+            std::vector<Greeks> getPrices(const std::vector<double>& strikes, bool isCall, const Exercise& exercise, const std::vector<double>& exerciseTimes = {});
+
+        private:
+            double S_, T_, r_, q_, sigma_;
+            std::size_t nodes_;
+            std::size_t timeSteps_;
+            double h_;
+            ExerciseMethod exerciseMethod_;
+            std::size_t iterations_;
+            std::vector<double> logSpots_;
+            // Spatial operator L (interior rows), Crank-Nicolson solves (I - dt/2 L)
+            double lower_, diagonal_, upper_;
+            TridiagonalSystem implicitSystem_;
+
+            void classSetter();
+    };
+
+    class HestonGrid
+    {
+        public:
+            // Uniform log-spot grid over +/- 6 standard deviations of max(v0, theta), variance grid on [0, max(1, 5*max(v0, theta))]
+            // refined near 0 by a sinh map (In 't Hout and Foulon, section 2)
+            HestonGrid(double S, double T, double r, double q, const Heston::Parameters& hestonParams, std::size_t spotNodes, std::size_t varianceNodes, std::size_t timeSteps);
+            ~HestonGrid() = default;
+
+            std::size_t getSpotNodes() const;
+            std::size_t getVarianceNodes() const;
+            std::size_t getTimeSteps() const;
+            const std::vector<double>& getVariances() const;
+
+            // American and Bermudan exercise project the ADI solution on the payoff after each step (or exercise date)
+            std::vector<Greeks> getPrices(const std::vector<double>& strikes, bool isCall, const Exercise& exercise, const std::vector<double>& exerciseTimes = {}) const;
+
+        private:
+            double S_, T_, r_, q_;
+            Heston::Parameters hestonParams_;
+            std::size_t spotNodes_;
+            std::size_t varianceNodes_;
+            std::size_t timeSteps_;
+            double h_;
+            std::vector<double> logSpots_;
+            std::vector<double> variances_;
+            // Three-point stencils of the variance derivatives on the non-uniform grid: [j*3 + (-1, 0, +1)]
+            std::vector<double> firstDerivative_;
+            std::vector<double> secondDerivative_;
+            // Implicit ADI systems: one per variance row in the spot direction, one shared by every spot column in the variance direction
+            std::vector<TridiagonalSystem> spotSystems_;
+            TridiagonalSystem varianceSystem_;
+
+            void classSetter();
+    };
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Hot-path metrics: counters and histograms sharded per thread (each thread only writes its own shard, relaxed atomics, no lock)
+// and merged when a snapshot is read. Shards of exited threads are folded into the registry so that nothing is lost.
+// The library is instrumented through the QUANT_METRIC_* macros below: they compile to nothing unless CPP_QUANT_METRICS is defined
+// (CMake option CPP_QUANT_ENABLE_METRICS), the Metrics functions themselves are always available.
+
+namespace Metrics
+{
+    enum class Counter : std::size_t
+    {
+        BLACK_REGION1, BLACK_REGION2, BLACK_REGION3, BLACK_REGION4,
+        IMPLIED_VOLATILITY_CALLS, IMPLIED_VOLATILITY_NAN,
+        LEWIS_PRICES,
+        NSS_OLS_FITS, NELSON_SIEGEL_CALIBRATIONS, SVENSSON_CALIBRATIONS,
+        DISCOUNT_CURVE_CALIBRATIONS,
+        COUNT
+    };
+
+    enum class Histogram : std::size_t
+    {
+        IMPLIED_VOLATILITY_ITERATIONS,
+        NELSON_SIEGEL_CALIBRATION_MICROSECONDS, SVENSSON_CALIBRATION_MICROSECONDS,
+        DISCOUNT_CURVE_CALIBRATION_MICROSECONDS,
+        COUNT
+    };
+
+    constexpr std::size_t COUNTERS = static_cast<std::size_t>(Counter::COUNT);
+    constexpr std::size_t HISTOGRAMS = static_cast<std::size_t>(Histogram::COUNT);
+    // Bucket 0 counts values below 1, bucket b >= 1 counts values in [2^(b-1), 2^b), the last bucket is open
+    constexpr std::size_t HISTOGRAM_BUCKETS = 40;
+
+    const char* getName(Counter counter);
+    const char* getName(Histogram histogram);
+    std::size_t getBucket(double value);
+
+    struct HistogramSnapshot
+    {
+        std::uint64_t count_;
+        double sum_, min_, max_;
+        std::array<std::uint64_t, HISTOGRAM_BUCKETS> buckets_;
+
+        double getMean() const;
+        // Upper bound of the bucket holding the p-quantile (NaN when empty)
+        double getPercentile(double p) const;
+    };
+
+    struct Snapshot
+    {
+        std::array<std::uint64_t, COUNTERS> counters_;
+        std::array<HistogramSnapshot, HISTOGRAMS> histograms_;
+
+        std::uint64_t getCounter(Counter counter) const;
+        const HistogramSnapshot& getHistogram(Histogram histogram) const;
+        // {"counters": {name: value}, "histograms": {name: {count, sum, min, max, mean, p50, p90, p99, buckets}}}
+        std::string toJson() const;
+        // One "name value" line per counter and one "name count=.. mean=.. p50=.. p90=.. p99=.. max=.." line per histogram
+        std::string toText() const;
+    };
+
+    void increment(Counter counter, std::uint64_t value = 1);
+    void record(Histogram histogram, double value);
+    // Merge of every live shard and of the exited threads
+    Snapshot getSnapshot();
+    // Values recorded concurrently with a reset may survive it
+    void reset();
+
+    // Records the elapsed microseconds of its scope
+    class ScopedTimer
+    {
+        public:
+            explicit ScopedTimer(Histogram histogram);
+            ~ScopedTimer();
+
+        private:
+            Histogram histogram_;
+            std::chrono::steady_clock::time_point start_;
+    };
+}
+
+#if defined(CPP_QUANT_METRICS)
+#define QUANT_METRIC_INCREMENT(counter) Metrics::increment(Metrics::Counter::counter)
+#define QUANT_METRIC_ADD(counter, value) Metrics::increment(Metrics::Counter::counter, value)
+#define QUANT_METRIC_RECORD(histogram, value) Metrics::record(Metrics::Histogram::histogram, value)
+#define QUANT_METRIC_TIMER(histogram) Metrics::ScopedTimer quantMetricTimer(Metrics::Histogram::histogram)
+#define QUANT_METRICS_ONLY(...) __VA_ARGS__
+#else
+#define QUANT_METRIC_INCREMENT(counter) ((void)0)
+#define QUANT_METRIC_ADD(counter, value) ((void)0)
+#define QUANT_METRIC_RECORD(histogram, value) ((void)0)
+#define QUANT_METRIC_TIMER(histogram) ((void)0)
+#define QUANT_METRICS_ONLY(...)
+#endif
@@ -0,0 +1,152 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include "black.hpp"
+#include "normal.hpp"
+
+// Batch Black price/Greeks and Lewis kernels templated on the scalar type: float halves the memory traffic and doubles the SIMD lanes
+// for scenario grids, the double instantiations of getPrices/getGreeks forward to UndiscountedBlack::getPrices/getGreeks (bit for bit).
+// The float path keeps the four regions of getCallPrice, each region is the expansion that stays accurate in float arithmetic
+// (asymptotic series in the deep out-of-the-money tail, Taylor series for small total volatility, erfcx difference elsewhere), and uses
+// a branch-free float erfcx (Numerical Recipes erfcc, relative error 1.2e-7) instead of the double kernels of NormalDistribution.
+// References
+// Numerical recipes in C - Press, Teukolsky, Vetterling and Flannery (1992) : section 6.2
+// Error bounds of the float path against the double path on the same (double) inputs, measured on x in [-12, 12] and s in [1e-3, 4]:
+//  - normalized price b(x, s): time value relative error <= 1e-6*(1 + h^2) with h = -|x|/s plus one float rounding of the intrinsic value,
+//    the h^2 term is the rounding of the inputs (d log b/d log x ~ h^2) so it cannot be removed in float; time values under ~1e-37
+//    (h < -13) underflow to 0
+//  - Greeks: relative error <= 2e-5 on every Greek, with an absolute floor of 1e-6*F (delta of deep in-the-money puts, vanna near d2 = 0)
+//  - Lewis prices: absolute error <= 1e-6 on b (cancellation of e^{x/2} against the quadrature sum), use the double path for deep
+//    out-of-the-money quotes
+// The float kernels only use the branch-free VectorMath exp and log, so the float region loops vectorize. The batch functions and
+// LewisPlan are compiled in src/tools/mixedprecision.cpp with the SIMD flags, and explicitly instantiated for float and double only
+
+namespace MixedPrecision
+{
+    // Float kernels of the normal distribution
+
+    QUANT_VECTOR_INLINE float getPdf(float x) {return 0.39894228f*VectorMath::getExp(-.5f*x*x);}
+
+    // exp(x^2)*erfc(x) = t*exp(P(t)) for x >= 0 with t = 1/(1 + x/2), reflection for x < 0
+    QUANT_VECTOR_INLINE float getErfcx(float x)
+    {
+        const float z = std::fabs(x), t = 1.0f/(1.0f + .5f*z);
+        const float positive = t*VectorMath::getExp(-1.26551223f + t*(1.00002368f + t*(.37409196f + t*(.09678418f + t*(-.18628806f + t*(.27886807f
+            + t*(-1.13520398f + t*(1.48851587f + t*(-.82215223f + t*.17087277f)))))))));
+        return x < 0.0f ? 2.0f*VectorMath::getExp(z*z) - positive : positive;
+    }
+
+    QUANT_VECTOR_INLINE float getCdf(float x)
+    {
+        const float tail = .5f*VectorMath::getExp(-.5f*x*x)*getErfcx(.70710678f*std::fabs(x));
+        return x < 0.0f ? tail : 1.0f - tail;
+    }
+
+    // Float versions of the call price regions of UndiscountedBlack (h = x/s <= 0, t = s/2)
+
+    // Asymptotic series sum_n (2n-1)!! q^n P_n(e) with P_n(e) = 2 (-1)^n sum_k C(2n+1, 2k+1) e^k, 8 terms reach float precision for h < -10
+    QUANT_VECTOR_INLINE float getCallPriceRegion1(float h, float t)
+    {
+        constexpr int terms = 8;
+        const float e = (t/h)*(t/h), r = (h + t)*(h - t), q = (h/r)*(h/r);
+        float sum = 0.0f;
+        // Both loops are unrolled so that the batch loop calling this kernel has no inner loop left and vectorizes
+        #pragma GCC unroll 8
+        for (int n = terms; n >= 1; --n)
+        {
+            // Odd binomial coefficients of row 2n+1, Horner in e from the highest power
+            float polynomial = 0.0f, binomial = 1.0f;
+            #pragma GCC unroll 9
+            for (int k = n; k >= 0; --k)
+            {
+                polynomial = polynomial*e + binomial;
+                binomial *= float((2*k + 1)*(2*k))/float((2*n + 2 - 2*k)*(2*n + 1 - 2*k));
+            }
+            sum = (n % 2 == 0 ? 2.0f : -2.0f)*polynomial + (n < terms ? float(2*n + 1)*q*sum : 0.0f);
+        }
+        return .39894228f*VectorMath::getExp(-.5f*(h*h + t*t))*(t/r)*(2.0f + q*sum);
+    }
+
+    QUANT_VECTOR_INLINE float getCallPriceRegion2(float h, float t)
+    {
+        const float a = 1.0f + h*1.25331414f*getErfcx(-.70710678f*h), w = t*t, h2 = h*h;
+        const float expansion = 2.0f*t*(a + w*((-1.0f + 3.0f*a + a*h2)/6.0f + w*((-7.0f + 15.0f*a + h2*(-1.0f + 10.0f*a + a*h2))/120.0f
+            + w*((-57.0f + 105.0f*a + h2*(-18.0f + 105.0f*a + h2*(-1.0f + 21.0f*a + a*h2)))/5040.0f
+            + w*((-561.0f + 945.0f*a + h2*(-285.0f + 1260.0f*a + h2*(-33.0f + 378.0f*a + h2*(-1.0f + 36.0f*a + a*h2))))/362880.0f)))));
+        return .39894228f*VectorMath::getExp(-.5f*(h*h + t*t))*expansion;
+    }
+
+    QUANT_VECTOR_INLINE float getCallPriceRegion3(float h, float t) {return getCdf(h + t)*VectorMath::getExp(h*t) - getCdf(h - t)*VectorMath::getExp(-h*t);}
+
+    QUANT_VECTOR_INLINE float getCallPriceRegion4(float h, float t)
+    {
+        return .5f*VectorMath::getExp(-.5f*(h*h + t*t))*(getErfcx(-.70710678f*(h + t)) - getErfcx(-.70710678f*(h - t)));
+    }
+
+    // Double overloads are the library kernels
+
+    inline double getPdf(double x) {return BlackTools::ONE_OVER_SQRT_TWO_PI*std::exp(-.5*x*x);}
+    inline double getCdf(double x) {return NormalDistribution::getCdf(x);}
+    inline double getCallPriceRegion1(double h, double t) {return UndiscountedBlack::getCallPriceRegion1(h, t);}
+    inline double getCallPriceRegion2(double h, double t) {return UndiscountedBlack::getCallPriceRegion2(h, t);}
+    inline double getCallPriceRegion3(double h, double t) {return UndiscountedBlack::getCallPriceRegion3(h, t);}
+    inline double getCallPriceRegion4(double h, double t) {return UndiscountedBlack::getCallPriceRegion4(h, t);}
+
+    // Normalized price b(x, s), same region boundaries as UndiscountedBlack::getCallPrice on the out-of-the-money side
+    template <typename Scalar>
+    inline Scalar getPrice(Scalar x, Scalar s, bool isCall)
+    {
+        const Scalar xc = isCall ? x : -x, xo = -std::fabs(xc), bm = std::exp(Scalar(.5)*xc);
+        const Scalar intrinsic = xc > 0 ? bm - 1/bm : Scalar(0);
+        if (!(s > 0)) return intrinsic;
+        const Scalar h = xo/s, t = Scalar(.5)*s;
+        if (xo < s*Scalar(BlackTools::H_LARGE) and Scalar(.5)*s*s + xo < s*Scalar(BlackTools::T_SMALL + BlackTools::H_LARGE)) return intrinsic + getCallPriceRegion1(h, t);
+        if (t < Scalar(BlackTools::T_SMALL)) return intrinsic + getCallPriceRegion2(h, t);
+        if (xo + Scalar(.5)*s*s > s*Scalar(.85)) return intrinsic + getCallPriceRegion3(h, t);
+        return intrinsic + getCallPriceRegion4(h, t);
+    }
+
+    // Batch prices: a block is partitioned by region and each region is priced in its own SIMD loop (as UndiscountedBlack::getPrices)
+    template <typename Scalar>
+    void getPrices(const Scalar* x, const Scalar* normalizedSigma, const bool* isCall, std::size_t n, Scalar* prices);
+
+    template <typename Scalar>
+    struct GreeksArrays
+    {
+        std::vector<Scalar> price_, delta_, gamma_, vega_, theta_, vanna_, volga_, charm_, veta_;
+    };
+
+    // Undiscounted Black-76 price and Greeks in (F, K, T, sigma), same conventions as UndiscountedBlack::getGreeks
+    template <typename Scalar>
+    void getGreeks(const Scalar* F, const Scalar* K, const Scalar* T, const Scalar* sigma, const bool* isCall, std::size_t n, GreeksArrays<Scalar>& greeks);
+
+    // Lewis prices of one maturity from the folded characteristic values (LewisQuadraturePlan::getFoldedCharacteristicValues), rounded to Scalar once
+    template <typename Scalar>
+    class LewisPlan
+    {
+        public:
+            LewisPlan(const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan, const std::complex<double>* foldedValues)
+            {
+                const std::vector<double>& nodes = lewisQuadraturePlan.getNodes();
+                for (std::size_t j = 0; j < nodes.size(); ++j)
+                {
+                    nodes_.push_back(Scalar(nodes[j]));
+                    real_.push_back(Scalar(foldedValues[j].real()));
+                    imaginary_.push_back(Scalar(foldedValues[j].imag()));
+                }
+            }
+            ~LewisPlan() = default;
+
+            Scalar getPrice(Scalar x, bool isCall) const;
+            void getPrices(const Scalar* x, std::size_t n, bool isCall, Scalar* prices) const;
+
+        private:
+            std::vector<Scalar> nodes_;
+            std::vector<Scalar> real_;
+            std::vector<Scalar> imaginary_;
+    };
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <cstdint>
+#include <cfloat>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "black.hpp"
+#include "normal.hpp"
+#include "threadpool.hpp"
+
+// Heston Monte Carlo under the forward measure: F_t = F_0*exp(X_t) with the variance simulated by Andersen's QE scheme
+// References
+// Efficient simulation of the Heston stochastic volatility model - Andersen (2008) : https://papers.ssrn.com/sol3/papers.cfm?abstract_id=946405
+// Parallel random numbers: as easy as 1, 2, 3 - Salmon, Moraes, Dror and Shaw (2011) : https://doi.org/10.1145/2063384.2063405
+// Paths are simulated in blocks of BLOCK_SIZE lanes, the random numbers of a path only depend on (seed, path, step) through a Philox4x32-10
+// counter so a price does not depend on the number of threads or on the scheduling
+
+namespace HestonMonteCarlo
+{
+    constexpr std::size_t BLOCK_SIZE = 8;
+
+    // Philox4x32-10 block: 4 random 32 bits words per (counter, key)
+    void getPhiloxBlock(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t output[4]);
+    // Pair of uniforms in (0,1) with 53 random bits for a (seed, path, step)
+    std::pair<double, double> getUniforms(std::uint64_t seed, std::uint64_t path, std::uint32_t step);
+
+    // Payoffs observe the forward on the simulation grid: forwards[i] = F(i*T/steps) for i = 0..steps (forwards[0] = F_0), undiscounted
+    class Payoff
+    {
+        public:
+            virtual ~Payoff() = default;
+            virtual double operator()(const double* forwards, std::size_t steps) const = 0;
+    };
+
+    class EuropeanPayoff final: public Payoff
+    {
+        public:
+            EuropeanPayoff(double K, bool isCall);
+            double operator()(const double* forwards, std::size_t steps) const override;
+            double getStrike() const;
+            bool isCall() const;
+
+        private:
+            double K_;
+            bool isCall_;
+    };
+
+    // Arithmetic average of the forward on the grid dates after 0
+    class AsianPayoff final: public Payoff
+    {
+        public:
+            AsianPayoff(double K, bool isCall);
+            double operator()(const double* forwards, std::size_t steps) const override;
+
+        private:
+            double K_;
+            bool isCall_;
+    };
+
+    enum class BarrierType {UP_AND_OUT, UP_AND_IN, DOWN_AND_OUT, DOWN_AND_IN};
+
+    // Vanilla payoff knocked in or out by the forward, the barrier is monitored on the grid dates after 0
+    class BarrierPayoff final: public Payoff
+    {
+        public:
+            BarrierPayoff(double K, double barrier, BarrierType type, bool isCall);
+            double operator()(const double* forwards, std::size_t steps) const override;
+
+        private:
+            double K_;
+            double barrier_;
+            BarrierType type_;
+            bool isCall_;
+    };
+
+    // Sum of the period returns clamped to [localFloor, localCap], then clamped to [globalFloor, globalCap] (unit notional)
+    // Resets are the grid dates round(j*steps/periods), the grid should have a multiple of periods steps
+    class CliquetPayoff final: public Payoff
+    {
+        public:
+            CliquetPayoff(std::size_t periods, double localFloor, double localCap, double globalFloor, double globalCap);
+            double operator()(const double* forwards, std::size_t steps) const override;
+
+        private:
+            std::size_t periods_;
+            double localFloor_;
+            double localCap_;
+            double globalFloor_;
+            double globalCap_;
+    };
+
+    struct Result
+    {
+        double price_;
+        double standardError_;
+        // Independent samples, an antithetic pair counts for one
+        std::size_t samples_;
+        // Regression coefficient of the control variate, 0 without control
+        double controlCoefficient_;
+    };
+
+    class Engine
+    {
+        public:
+            Engine(const Heston::Parameters& hestonParams, double F, double T, std::size_t steps);
+            ~Engine() = default;
+
+            void setPaths(std::size_t paths);
+            void setSeed(std::uint64_t seed);
+            // Maximum number of workers on the shared ThreadPool (which caps it at its threads + the caller), 0 uses std::thread::hardware_concurrency
+            void setThreads(std::size_t threads);
+            void setAntithetic(bool antithetic);
+
+            std::size_t getSteps() const;
+            std::size_t getPaths() const;
+            std::size_t getThreads() const;
+            bool isAntithetic() const;
+
+            Result getPrice(const Payoff& payoff) const;
+            // Control variate with a known expectation, the coefficient is estimated on the same paths
+            Result getPrice(const Payoff& payoff, const Payoff& control, double controlExpectation) const;
+            // European control priced by Heston::getUndiscountedLewisPrice
+            Result getPrice(const Payoff& payoff, const EuropeanPayoff& control, const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan) const;
+
+            // Grid forwards of one path, path-major (paths x (steps+1)), for inspection and tests
+            std::vector<double> getPaths(std::size_t firstPath, std::size_t paths, bool antithetic) const;
+
+        private:
+            // Moments of a chunk of samples, chunks are reduced in their order
+            struct Moments
+            {
+                double n_, y_, c_, yy_, cc_, yc_;
+            };
+
+            Heston::Parameters hestonParams_;
+            double F_;
+            double T_;
+            std::size_t steps_;
+            std::size_t paths_;
+            std::uint64_t seed_;
+            std::size_t threads_;
+            bool antithetic_;
+
+            void simulateBlock(std::size_t firstPath, bool antithetic, double* forwards) const;
+            Result getResult(const Payoff& payoff, const Payoff* control, double controlExpectation) const;
+    };
+}
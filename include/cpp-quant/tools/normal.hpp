@@ -0,0 +1,108 @@
+#pragma once
+#include <cmath>
+#include <cfloat>
+#include <cstddef>
+#include "vectormath.hpp"
+
+// Standard normal kernels for the pricing hot loops (stateless, inlinable, no object per call), the batch variants are compiled in
+// src/tools/normal.cpp with the SIMD flags of the library
+// References
+// Handbook of mathematical functions - Abramowitz and Stegun (1964) : 26.2.17 and 7.1.26
+// An algorithm for computing the inverse normal cumulative distribution function - Acklam (2003) : https://web.archive.org/web/20151030215612/http://home.online.no/~pjacklam/notes/invnorm/
+// Rational Chebyshev approximations for the error function - Cody (1969) : https://doi.org/10.1090/S0025-5718-1969-0247736-4
+
+namespace NormalDistribution
+{
+    constexpr double SQRT_PI = 1.77245385090551602730;
+    constexpr double SQRT_TWO_PI = 2.50662827463100050242;
+    constexpr double ONE_OVER_SQRT_TWO = 0.7071067811865475244008443621048490392848359376887;
+    constexpr double ONE_OVER_SQRT_TWO_PI = 0.3989422804014326779399460599343818684758586311649;
+
+    // FULL is accurate to a few ulps, FAST trades accuracy for branch-free polynomial kernels (cdf ~1e-7 absolute, quantile ~1e-9 relative)
+    // built on tools/vectormath.hpp: no libm call and selects only, the same code runs in the scalar and in the vectorized batch loops
+    enum class Accuracy {FULL, FAST};
+
+    // exp(x*x) with the rounding error of x*x carried to first order, keeps full relative accuracy for large |x|
+    inline double getExpSquare(double x)
+    {
+        const double hi = x*x, lo = std::fma(x, x, -hi);
+        return std::exp(hi)*(1.0 + lo);
+    }
+
+    // Same first-order correction for exp(-x*x/2) (x/2 is exact)
+    inline double getExpMinusHalfSquare(double x)
+    {
+        const double hi = .5*x*x, lo = std::fma(.5*x, x, -hi);
+        return std::exp(-hi)*(1.0 - lo);
+    }
+
+    inline double getPdf(double x) {return ONE_OVER_SQRT_TWO_PI*getExpMinusHalfSquare(x);}
+
+    // Scaled complementary error function exp(x^2)*erfc(x): direct evaluation below 4, fixed-depth continued fraction above
+    inline double getErfcx(double x)
+    {
+        if (x < 0.0) return (x < -26.6) ? HUGE_VAL : 2.0*getExpSquare(x) - getErfcx(-x);
+        if (x < 4.0) return getExpSquare(x)*std::erfc(x);
+        double t = x;
+        for (int n = 20; n >= 1; --n) t = x + .5*n/t;
+        return 1.0/(SQRT_PI*t);
+    }
+
+    template <Accuracy accuracy = Accuracy::FULL>
+    QUANT_VECTOR_INLINE double getCdf(double x)
+    {
+        // In the lower tail erfc(-x/sqrt(2)) amplifies the rounding of x/sqrt(2), the Gaussian factor is taken exactly from x instead
+        if constexpr (accuracy == Accuracy::FULL) return (x < -1.0) ? .5*getExpMinusHalfSquare(x)*getErfcx(-ONE_OVER_SQRT_TWO*x) : .5*std::erfc(-ONE_OVER_SQRT_TWO*x);
+        else
+        {
+            const double z = std::fabs(x), k = 1.0/(1.0 + 0.2316419*z);
+            const double pdf = ONE_OVER_SQRT_TWO_PI*VectorMath::getExpMinusHalfSquare(z);
+            const double tail = pdf*k*(0.319381530 + k*(-0.356563782 + k*(1.781477937 + k*(-1.821255978 + k*1.330274429))));
+            return (x < 0.0) ? tail : 1.0 - tail;
+        }
+    }
+
+    // Acklam's approximation of the quantile of a lower tail probability p in (0, 1/2]: both rational functions are evaluated and the
+    // region is selected. p is scaled by 2^54 before the logarithm so that denormal probabilities are covered without a select.
+    QUANT_VECTOR_INLINE double getLowerQuantile(double p)
+    {
+        constexpr double LN2_TIMES_54 = 37.429947750237047, TWO_POW_54 = 18014398509481984.0;
+        const double q = std::sqrt(2.0*(LN2_TIMES_54 - VectorMath::getLog(p*TWO_POW_54)));
+        const double tailNumerator = ((((-7.784894002430293e-03*q - 3.223964580411365e-01)*q - 2.400758277161838e+00)*q - 2.549732539343734e+00)*q + 4.374664141464968e+00)*q + 2.938163982698783e+00;
+        const double tailDenominator = (((7.784695709041462e-03*q + 3.224671290700398e-01)*q + 2.445134137142996e+00)*q + 3.754408661907416e+00)*q + 1.0;
+        const double c = p - .5, r = c*c;
+        const double centralNumerator = (((((-3.969683028665376e+01*r + 2.209460984245205e+02)*r - 2.759285104469687e+02)*r + 1.383577518672690e+02)*r - 3.066479806614716e+01)*r + 2.506628277459239e+00)*c;
+        const double centralDenominator = ((((-5.447609879822406e+01*r + 1.615858368580409e+02)*r - 1.556989798598866e+02)*r + 6.680131188771972e+01)*r - 1.328068155288572e+01)*r + 1.0;
+        // The region is selected before the division, a single one per call
+        const bool isTail = p < 0.02425;
+        return (isTail ? tailNumerator : centralNumerator)/(isTail ? tailDenominator : centralDenominator);
+    }
+
+    template <Accuracy accuracy = Accuracy::FULL>
+    QUANT_VECTOR_INLINE double getQuantile(double p)
+    {
+        if constexpr (accuracy == Accuracy::FAST)
+        {
+            // 1-p is exact for p >= 1/2, the lower tail is always the one solved
+            const double x = getLowerQuantile(p > .5 ? 1.0 - p : p), quantile = p > .5 ? -x : x;
+            return p <= 0.0 ? -HUGE_VAL : (p >= 1.0 ? HUGE_VAL : (p == p ? quantile : p));
+        }
+        if (p <= 0.0) return -HUGE_VAL;
+        if (p >= 1.0) return HUGE_VAL;
+        // 1-p is exact for p >= 1/2, the lower tail is always the one solved
+        const double lower = p > .5 ? 1.0 - p : p, x = getLowerQuantile(lower);
+        // One Halley step on the lower tail brings Acklam's 1.15e-9 to machine precision
+        const double u = (getCdf(x) - lower)*SQRT_TWO_PI*std::exp(.5*x*x), quantile = x - u/(1.0 + .5*x*u);
+        return p > .5 ? -quantile : quantile;
+    }
+
+    // Batch variants (n values), vectorized loops on the tools/vectormath.hpp kernels: pdf, erfcx and the FULL cdf are within a few ulps of
+    // the scalar functions, the FAST tiers return the scalar values, the FULL quantile applies the same Halley step to the FAST one
+    // (except on denormal probabilities, which keep Acklam's 1e-9 relative accuracy)
+    void getPdf(const double* x, std::size_t n, double* output);
+    void getErfcx(const double* x, std::size_t n, double* output);
+    template <Accuracy accuracy = Accuracy::FULL>
+    void getCdf(const double* x, std::size_t n, double* output);
+    template <Accuracy accuracy = Accuracy::FULL>
+    void getQuantile(const double* p, std::size_t n, double* output);
+}
@@ -1,6 +1,8 @@
 #pragma once 
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <thread>
 #include "cpp-math/regression.hpp"
 #include "cpp-math/curveinterpolation.hpp"
 #include "cpp-math/optim.hpp"
@@ -21,6 +23,10 @@ class NelsonSiegelFamily
         virtual double getDerivativeInstantaneousForwardRate(double t) const = 0;
         virtual double getBeta0() const = 0;
         virtual double getBeta1() const = 0;
+        // Rates, forward rates and forward rate derivatives on n maturities (null outputs are skipped). The default loops over the
+        // scalar functions. NelsonSiegel and Svensson share the exponentials by the three outputs and compute them in SIMD loops,
+        // their overrides are final: no dispatch when called on the concrete type
+        virtual void evaluate(const double* maturities, std::size_t n, double* rates, double* forwardRates, double* derivativeForwardRates) const;
 
         static double rateFuntion1(double t, double tau);
         static double rateFuntion2(double t, double tau);
@@ -38,6 +44,7 @@ class NelsonSiegel : public NelsonSiegelFamily
         double getRate(double t) const override; 
         double getInstantaneousForwardRate(double t) const override;
         double getDerivativeInstantaneousForwardRate(double t) const override;
+        void evaluate(const double* maturities, std::size_t n, double* rates, double* forwardRates, double* derivativeForwardRates) const final;
 
         double getBeta1() const override; 
         double getBeta2() const; 
@@ -66,6 +73,7 @@ class Svensson final: public NelsonSiegelFamily
         double getRate(double t) const override; 
         double getInstantaneousForwardRate(double t) const override;
         double getDerivativeInstantaneousForwardRate(double t) const override;
+        void evaluate(const double* maturities, std::size_t n, double* rates, double* forwardRates, double* derivativeForwardRates) const final;
 
         double getBeta1() const override; 
         double getBeta2() const; 
@@ -90,27 +98,166 @@ class Svensson final: public NelsonSiegelFamily
         double tau2_;
 };
 
+// Fit at fixed taus (beta3_ = 0 for Nelson-Siegel), betas and mean squared error are NaN when the regressors are collinear
+struct NelsonSiegelFit
+{
+    double beta0_, beta1_, beta2_, beta3_, tau1_, tau2_, meanSquaredError_;
+    bool useSvensson_;
+
+    std::shared_ptr<NelsonSiegelFamily> getCurve() const;
+};
+
+struct VariableProjectionResult
+{
+    NelsonSiegelFit fit_;
+    std::size_t iterations_;
+    bool converged_;
+};
+
 class NelsonSiegelCalibration
 {
     public:
+        // NELDER_MEAD: derivative-free search on the taus.
+        // VARIABLE_PROJECTION: Levenberg-Marquardt on log-taus with the betas eliminated by OLS, analytic (Kaufman) Jacobian.
+        enum class CalibrationMethod {NELDER_MEAD, VARIABLE_PROJECTION};
+
         NelsonSiegelCalibration(const std::map<double, double>& data, bool isSpotRate);
         ~NelsonSiegelCalibration() = default;
 
         
         std::shared_ptr<NelsonSiegelFamily> fitOLS(double tau1, double tau2, bool useSvensson) const; 
+        // Closed-form OLS on the 2 (3 for Svensson) regressors plus intercept: a single pass over the data updating the centered
+        // cross products in registers, Cholesky on the stack, the mean squared error from the same factorization, no allocation
+        NelsonSiegelFit getFit(double tau1, double tau2, bool useSvensson) const;
         std::shared_ptr<NelsonSiegelFamily> fitNelsonSiegel() const; 
         std::shared_ptr<NelsonSiegelFamily> fitSvensson() const; 
+        // Starts from the given taus (tau2 ignored for Nelson-Siegel), the Jacobian and the Gauss-Newton system come out of the
+        // same single pass as the OLS fit, no allocation
+        VariableProjectionResult fitVariableProjection(double tau1, double tau2, bool useSvensson) const;
         void setGridSize(double value); 
+        void setCalibrationMethod(CalibrationMethod value);
+        CalibrationMethod getCalibrationMethod() const;
+        // Coarse-to-fine: each refinement searches +/- one step around the winner with a step four times smaller
+        void setGridRefinements(std::size_t value);
+        // Maximum number of workers of the grid search on the shared ThreadPool, 0 uses the hardware concurrency
+        void setThreads(std::size_t value);
+        std::size_t getThreads() const;
 
     private: 
         std::map<double, double> data_;
         bool isSpotRate_;
         double gridSize_;
+        std::size_t gridRefinements_;
+        std::size_t threads_;
+        CalibrationMethod calibrationMethod_;
+
+        // The session restarts from the grid winner when its fit has degraded
+        friend class NelsonSiegelCalibrationSession;
 
-        EstimatorLoss getLoss(double tau1, double tau2, bool useSvensson) const;
+        // Taus in {gridSize, 2 gridSize, ...} up to the first past the last maturity minimizing the OLS mean squared error.
+        // Basis columns are computed once per tau and every candidate is a 2x2 (3x3 for Svensson) solve on centered cross products,
+        // b(tau1).b(tau2) is shared by (tau1, tau2) and (tau2, tau1), tau1 rows are spread over the pool.
         double getNelsonSiegelIniatialTau() const;
         std::vector<double>  getSvenssonIniatialTau() const;
+};
+
+// Recalibrates the same curve on successive quotes. An update first refits the betas at the previous taus, through the cached
+// centered basis and Cholesky factor when the maturities did not change (no exponential), then moves the taus by variable
+// projection from the previous solution, and only runs the full grid search when the fit has degraded past the fallback threshold.
+// Thresholds are relative increases of the root mean squared error over the last full calibration, with an absolute floor.
+class NelsonSiegelCalibrationSession
+{
+    public:
+        enum class UpdatePath {FULL, INCREMENTAL};
+
+        NelsonSiegelCalibrationSession(bool isSpotRate, bool useSvensson);
+        ~NelsonSiegelCalibrationSession() = default;
+
+        const NelsonSiegelFit& update(const std::map<double, double>& data);
+        // Forgets the previous solution, the next update takes the full path
+        void reset();
+
+        const NelsonSiegelFit& getFit() const;
+        std::shared_ptr<NelsonSiegelFamily> getCurve() const;
+        UpdatePath getLastPath() const;
+        // Variable projection iterations of the last update (0 when the previous taus were kept)
+        std::size_t getLastIterations() const;
+        std::size_t getFullUpdates() const;
+        std::size_t getIncrementalUpdates() const;
+
+        // Keep the previous taus below this degradation (default 5%)
+        void setTolerance(double value);
+        // Full grid search above this degradation after the warm start (default 50%)
+        void setFallbackThreshold(double value);
+        // Root mean squared error under which both thresholds always pass (default 1e-6, a hundredth of a basis point)
+        void setAbsoluteTolerance(double value);
+        void setGridSize(double value);
+        void setGridRefinements(std::size_t value);
+        void setThreads(std::size_t value);
+
+    private:
+        bool isSpotRate_;
+        bool useSvensson_;
+        double tolerance_;
+        double fallbackThreshold_;
+        double absoluteTolerance_;
+        double gridSize_;
+        std::size_t gridRefinements_;
+        std::size_t threads_;
+
+        bool hasFit_;
+        NelsonSiegelFit fit_;
+        double referenceMeanSquaredError_;
+        UpdatePath lastPath_;
+        std::size_t lastIterations_;
+        std::size_t fullUpdates_;
+        std::size_t incrementalUpdates_;
+
+        // Centered basis at the taus of fit_ (row major, one row per maturity), its means and the Cholesky factor of its Gram matrix
+        std::vector<double> maturities_;
+        std::vector<double> basis_;
+        double basisMean_[3];
+        double factor_[3][3];
+
+        void setFactorization(const std::map<double, double>& data);
+        NelsonSiegelFit getCachedFit(const std::map<double, double>& data) const;
+};
+
+// Fits of many curves quoted on the same maturities (historical backfills). The centered basis of every tau on the grid and the
+// Cholesky factor of every candidate (tau1, tau2) Gram matrix only depend on the maturities: they are built once, in parallel, and
+// shared by all curves. A curve then costs two dot products per tau, one triangular solve per candidate and a variable
+// projection polish from the grid winner. Curves are spread over the shared ThreadPool.
+// The Svensson cache holds 3 doubles per (tau1, tau2): about 90 KB on the default grid, growing with the square of 1/gridSize.
+class NelsonSiegelBatchCalibration
+{
+    public:
+        NelsonSiegelBatchCalibration(const std::vector<double>& maturities, bool isSpotRate, bool useSvensson);
+        ~NelsonSiegelBatchCalibration() = default;
+
+        // yields[c*maturities + k] is curve c at maturity k
+        std::vector<NelsonSiegelFit> fit(const double* yields, std::size_t curves) const;
+        std::vector<NelsonSiegelFit> fit(const std::vector<std::vector<double>>& yields) const;
+
+        // Same grid as NelsonSiegelCalibration::setGridSize, the cache is rebuilt on the next fit
+        void setGridSize(double value);
+        // Maximum number of workers on the shared ThreadPool, 0 uses the hardware concurrency
+        void setThreads(std::size_t value);
+        std::size_t getThreads() const;
+        // Candidates (taus, or tau pairs for Svensson) with a cached factorization, 0 before the first fit
+        std::size_t getCachedCandidates() const;
+
+    private:
+        struct BasisCache;
+
+        std::vector<double> maturities_;
+        bool isSpotRate_;
+        bool useSvensson_;
+        double gridSize_;
+        std::size_t threads_;
+        mutable std::mutex mutex_;
+        mutable std::shared_ptr<const BasisCache> cache_;
 
+        std::shared_ptr<const BasisCache> getCache() const;
 };
 
 
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include "black.hpp"
+
+// Option chain processing: forward/discount normalization, Black implied volatility and Black Greeks per quote
+// Quotes are sharded in contiguous ranges across workers, a worker that drains its range steals chunks from the others
+// Results are written at the index of their quote (output order does not depend on the scheduling) and failures are reported per quote
+
+namespace OptionChain
+{
+    enum class QuoteStatus : std::uint8_t {OK, INVALID_INPUT, NO_TIME_VALUE, ABOVE_UPPER_BOUND, SOLVER_FAILURE};
+
+    // Discounted premium on an underlying with continuous rate and dividend yield, F = S*exp((r-q)*T) and D = exp(-r*T)
+    struct RawQuote
+    {
+        RawQuote(double price, double spot, double strike, double maturity, double rate, double dividendYield, bool isCall);
+        double price_;
+        double spot_;
+        double strike_;
+        double maturity_;
+        double rate_;
+        double dividendYield_;
+        bool isCall_;
+    };
+
+    // Greeks are the undiscounted Black-76 Greeks of UndiscountedBlack::getGreeks (forward measure), NaN unless status_ is OK
+    struct Result
+    {
+        double forward_;
+        double discountFactor_;
+        double impliedVolatility_;
+        UndiscountedBlack::Greeks greeks_;
+        QuoteStatus status_;
+    };
+
+    Result getResult(const RawQuote& quote, const ImpliedVolatilitySolver::SolverMethod& method);
+
+    class Pipeline
+    {
+        public:
+            // Maximum number of workers on the shared ThreadPool, 0 uses std::thread::hardware_concurrency
+            explicit Pipeline(std::size_t threads);
+            Pipeline();
+            ~Pipeline() = default;
+
+            void setChunkSize(std::size_t chunkSize);
+            void setSolverMethod(const ImpliedVolatilitySolver::SolverMethod& method);
+
+            std::size_t getThreads() const;
+            std::size_t getChunkSize() const;
+            // Chunks processed by a worker other than the owner of their range during the last run
+            std::size_t getStolenChunks() const;
+
+            std::vector<Result> process(const std::vector<RawQuote>& quotes);
+            void process(const RawQuote* quotes, std::size_t n, Result* results);
+
+        private:
+            // One cursor per range and per cache line, owner and thieves claim chunks with the same fetch_add
+            struct alignas(64) Shard
+            {
+                std::atomic<std::size_t> next_;
+                std::size_t end_;
+            };
+
+            std::size_t threads_;
+            std::size_t chunkSize_;
+            ImpliedVolatilitySolver::SolverMethod method_;
+            std::atomic<std::size_t> stolenChunks_;
+    };
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Process-wide pool of worker threads shared by the parallel entry points of the library (Heston surface and calibration, Monte Carlo,
+// option chains, Nelson-Siegel grids): threads are created once, on first use, instead of being spawned and joined at every call.
+// run(workers, worker) calls worker(w) once for every w < workers and returns when all of them have returned. worker(0) runs on the
+// calling thread, the other indexes are claimed one at a time by the idle pool threads and by the caller itself: a run issued from a
+// worker, or while the pool is busy with another run, always completes on the caller (no deadlock, no oversubscription).
+// The first exception thrown by a worker is rethrown by run once every worker has returned.
+
+class ThreadPool
+{
+    public:
+        // hardware_concurrency - 1 threads, the caller of run is the last one
+        static ThreadPool& getInstance();
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        std::size_t getThreads() const;
+        void run(std::size_t workers, const std::function<void(std::size_t)>& worker);
+
+    private:
+        struct Job;
+        explicit ThreadPool(std::size_t threads);
+
+        // Next index of the job or workers when every index has been claimed (the job then leaves the queue)
+        std::size_t claim(const std::shared_ptr<Job>& job);
+        void execute(Job& job, std::size_t index);
+        void loop();
+
+        std::vector<std::thread> threads_;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        std::deque<std::shared_ptr<Job>> jobs_;
+        bool stopping_;
+};
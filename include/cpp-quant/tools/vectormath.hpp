@@ -0,0 +1,196 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Branch-free elementary functions for the library SIMD loops: straight-line polynomial code and bit manipulations only, so that the
+// compiler can inline them in a vectorized loop (libm calls are opaque and keep a loop scalar). The selects become vector masks only
+// when the including translation unit is compiled with -fno-trapping-math (see CPP_QUANT_SIMD_SOURCES in cmake/Lib.cmake).
+// References
+// Software manual for the elementary functions - Cody and Waite (1980)
+// A method for extending the precision of floating-point arithmetic - Dekker (1971) : https://doi.org/10.1007/BF01397083
+// Chebyshev approximation of (1+2x)exp(x^2)erfc(x) in 0 <= x < infinity - Shepherd and Laframboise (1981)
+
+// A kernel left as a call keeps the calling loop scalar, GCC and Clang are told to inline them whatever their size
+#if defined(__GNUC__)
+#define QUANT_VECTOR_INLINE inline __attribute__((always_inline))
+#else
+#define QUANT_VECTOR_INLINE inline
+#endif
+
+namespace VectorMath
+{
+    constexpr double SQRT_PI = 1.77245385090551602730;
+    constexpr double ONE_OVER_SQRT_TWO = 0.7071067811865475244008443621048490392848359376887;
+
+    QUANT_VECTOR_INLINE double getDouble(std::uint64_t bits) {double x; std::memcpy(&x, &bits, sizeof(x)); return x;}
+    QUANT_VECTOR_INLINE std::uint64_t getBits(double x) {std::uint64_t bits; std::memcpy(&bits, &x, sizeof(bits)); return bits;}
+    QUANT_VECTOR_INLINE float getFloat(std::uint32_t bits) {float x; std::memcpy(&x, &bits, sizeof(x)); return x;}
+    QUANT_VECTOR_INLINE std::uint32_t getBits(float x) {std::uint32_t bits; std::memcpy(&bits, &x, sizeof(bits)); return bits;}
+
+    // Cody-Waite reduction by ln 2 and a degree 13 polynomial on |r| <= ln 2/2, 2^k written in the exponent bits (within 2 ulp of
+    // std::exp). Arguments are clamped to [-708, 709]: no denormal, no overflow.
+    QUANT_VECTOR_INLINE double getExp(double x)
+    {
+        constexpr double LOG2_E = 1.4426950408889634, LN2_HI = 6.93147180369123816490e-01, LN2_LO = 1.90821492927058770002e-10;
+        // 1.5 2^52 + 1023: the low mantissa bits of x log2(e) + SHIFT hold the biased exponent k + 1023
+        constexpr double SHIFT = 6755399441055744.0 + 1023.0;
+        x = x < -708.0 ? -708.0 : x;
+        x = x > 709.0 ? 709.0 : x;
+        const double shifted = x*LOG2_E + SHIFT;
+        const double k = shifted - SHIFT;
+        const double r = (x - k*LN2_HI) - k*LN2_LO;
+        double p = 1.0/6227020800.0;
+        p = p*r + 1.0/479001600.0;
+        p = p*r + 1.0/39916800.0;
+        p = p*r + 1.0/3628800.0;
+        p = p*r + 1.0/362880.0;
+        p = p*r + 1.0/40320.0;
+        p = p*r + 1.0/5040.0;
+        p = p*r + 1.0/720.0;
+        p = p*r + 1.0/120.0;
+        p = p*r + 1.0/24.0;
+        p = p*r + 1.0/6.0;
+        p = p*r + .5;
+        p = p*r + 1.0;
+        p = p*r + 1.0;
+        return p*getDouble(getBits(shifted) << 52);
+    }
+
+    // x = 2^k m with m in [sqrt(1/2), sqrt(2)), log(m) = 2 atanh(s) with s = (m-1)/(m+1), |s| <= 0.1716, odd series to s^23 (within
+    // 2 ulp of std::log). Only for positive normal finite arguments: zero, negative, denormal, infinite and NaN are not detected.
+    QUANT_VECTOR_INLINE double getLog(double x)
+    {
+        constexpr double LN2_HI = 6.93147180369123816490e-01, LN2_LO = 1.90821492927058770002e-10;
+        constexpr std::uint64_t ONE = 0x3FF0000000000000ULL, SQRT_HALF = 0x3FE6A09E667F3BCDULL;
+        // Biased exponent of x/sqrt(1/2), read in the low mantissa bits of 2^52 to convert it without an integer to double instruction
+        const std::uint64_t biased = (getBits(x) + (ONE - SQRT_HALF)) >> 52;
+        const double k = getDouble(0x4330000000000000ULL | biased) - (4503599627370496.0 + 1023.0);
+        const double f = getDouble(getBits(x) - (biased << 52) + ONE) - 1.0;
+        const double s = f/(2.0 + f), z = s*s;
+        double p = 1.0/23.0;
+        p = p*z + 1.0/21.0;
+        p = p*z + 1.0/19.0;
+        p = p*z + 1.0/17.0;
+        p = p*z + 1.0/15.0;
+        p = p*z + 1.0/13.0;
+        p = p*z + 1.0/11.0;
+        p = p*z + 1.0/9.0;
+        p = p*z + 1.0/7.0;
+        p = p*z + 1.0/5.0;
+        p = p*z + 1.0/3.0;
+        // log(m) = f - f s + s z p' rewritten as 2s + 2s z p' with the leading term kept exact
+        const double tail = 2.0*s*z*p;
+        return k*LN2_HI + (f - s*f + (tail + k*LN2_LO));
+    }
+
+    // Float exp, same reduction with ln 2 split in 9 + 24 bits and a degree 7 polynomial (within 2 ulp of std::exp in float).
+    // Arguments above 88 are clamped, below -87 the result is flushed to 0 (no denormal).
+    QUANT_VECTOR_INLINE float getExp(float x)
+    {
+        constexpr float LOG2_E = 1.44269504f, LN2_HI = .693359375f, LN2_LO = -2.12194440e-4f;
+        // 1.5 2^23 + 127: the low mantissa bits of x log2(e) + SHIFT hold the biased exponent k + 127
+        constexpr float SHIFT = 12582912.0f + 127.0f;
+        const float clamped = x < -87.0f ? -87.0f : (x > 88.0f ? 88.0f : x);
+        const float shifted = clamped*LOG2_E + SHIFT;
+        const float k = shifted - SHIFT;
+        const float r = (clamped - k*LN2_HI) - k*LN2_LO;
+        float p = 1.0f/5040.0f;
+        p = p*r + 1.0f/720.0f;
+        p = p*r + 1.0f/120.0f;
+        p = p*r + 1.0f/24.0f;
+        p = p*r + 1.0f/6.0f;
+        p = p*r + .5f;
+        p = p*r + 1.0f;
+        p = p*r + 1.0f;
+        return x < -87.0f ? 0.0f : p*getFloat(getBits(shifted) << 23);
+    }
+
+    // Float log, same reduction and odd series to s^11 (within 2 ulp of std::log in float), positive normal finite arguments only
+    QUANT_VECTOR_INLINE float getLog(float x)
+    {
+        constexpr float LN2_HI = .693359375f, LN2_LO = -2.12194440e-4f;
+        constexpr std::uint32_t ONE = 0x3F800000U, SQRT_HALF = 0x3F3504F3U;
+        const std::uint32_t biased = (getBits(x) + (ONE - SQRT_HALF)) >> 23;
+        const float k = getFloat(0x4B000000U | biased) - (8388608.0f + 127.0f);
+        const float f = getFloat(getBits(x) - (biased << 23) + ONE) - 1.0f;
+        const float s = f/(2.0f + f), z = s*s;
+        float p = 1.0f/11.0f;
+        p = p*z + 1.0f/9.0f;
+        p = p*z + 1.0f/7.0f;
+        p = p*z + 1.0f/5.0f;
+        p = p*z + 1.0f/3.0f;
+        const float tail = 2.0f*s*z*p;
+        return k*LN2_HI + (f - s*f + (tail + k*LN2_LO));
+    }
+
+    // Rounding error of the product x*y (x*y = hi + lo exactly). Without hardware fma std::fma is a libm call, Dekker's product
+    // splits the factors in 26-bit halves instead (no contraction can happen then, the target has no fma instruction)
+    QUANT_VECTOR_INLINE double getProductError(double x, double y, double hi)
+    {
+#ifdef __FMA__
+        return std::fma(x, y, -hi);
+#else
+        constexpr double SPLITTER = 134217729.0;
+        const double cx = SPLITTER*x, cy = SPLITTER*y;
+        const double xh = cx - (cx - x), xl = x - xh, yh = cy - (cy - y), yl = y - yh;
+        return ((xh*yh - hi) + xh*yl + xl*yh) + xl*yl;
+#endif
+    }
+
+    // exp(x*x) and exp(-x*x/2) with the rounding error of the square carried to first order (same as NormalDistribution)
+    QUANT_VECTOR_INLINE double getExpSquare(double x)
+    {
+        const double hi = x*x, lo = getProductError(x, x, hi);
+        return getExp(hi)*(1.0 + lo);
+    }
+
+    QUANT_VECTOR_INLINE double getExpMinusHalfSquare(double x)
+    {
+        const double hi = .5*x*x, lo = getProductError(.5*x, x, hi);
+        return getExp(-hi)*(1.0 - lo);
+    }
+
+    // Scaled complementary error function exp(x^2)*erfc(x). On x >= 0 (1+sqrt(pi)x)erfcx(x) goes from 1 to 1 and is a degree 23
+    // polynomial of u = (x-3)/(x+3) in [-1, 1] (Shepherd and Laframboise mapping, Chebyshev fit converted to monomials, within 3 ulp).
+    // Negative arguments use erfcx(x) = 2exp(x^2) - erfcx(-x), which overflows to exp(709) below -26.6.
+    QUANT_VECTOR_INLINE double getErfcx(double x)
+    {
+        double z = std::fabs(x);
+        z = z > 1e300 ? 1e300 : z;
+        const double u = (z - 3.0)/(z + 3.0);
+        double p = 8.88513573014043954e-10;
+        p = p*u - 2.74669469887738687e-09;
+        p = p*u - 1.18909844709976932e-08;
+        p = p*u + 2.38800360185930889e-08;
+        p = p*u + 9.02620167290913878e-08;
+        p = p*u - 1.01810634379193430e-07;
+        p = p*u - 5.43060517125975997e-07;
+        p = p*u + 2.71993840565502696e-07;
+        p = p*u + 3.04375155597328882e-06;
+        p = p*u - 4.94695745831220880e-07;
+        p = p*u - 1.75723862950109060e-05;
+        p = p*u + 3.47399667380350965e-06;
+        p = p*u + 1.09403210195641528e-04;
+        p = p*u - 8.59062381279728529e-05;
+        p = p*u - 6.85959516861763658e-04;
+        p = p*u + 1.60587844850472862e-03;
+        p = p*u + 2.32213762002999972e-03;
+        p = p*u - 2.05803575628727108e-02;
+        p = p*u + 5.77612034134763822e-02;
+        p = p*u - 9.75498893792865335e-02;
+        p = p*u + 9.78158787627484566e-02;
+        p = p*u - 1.42078862510081668e-02;
+        p = p*u - 1.57307671053878384e-01;
+        p = p*u + 1.13081499036531508e+00;
+        const double positive = p/(1.0 + SQRT_PI*z), reflected = 2.0*getExpSquare(x) - positive;
+        return x < 0.0 ? reflected : positive;
+    }
+
+    // Standard normal cdf from the tail .5 exp(-x^2/2) erfcx(|x|/sqrt(2)), the Gaussian factor is taken exactly from x
+    QUANT_VECTOR_INLINE double getCdf(double x)
+    {
+        const double tail = .5*getExpMinusHalfSquare(x)*getErfcx(ONE_OVER_SQRT_TWO*std::fabs(x));
+        return x < 0.0 ? tail : 1.0 - tail;
+    }
+}
@@ -34,7 +34,11 @@ class DiscountCurve final: public TermStructure
         
         std::optional<InterpolationMethod> getInterpolationMethod() const;
         std::shared_ptr<Svensson> getSvenssonObject() const;
+        // Seconds spent fitting the curve to the data (0 when built from a Svensson object)
+        double getCalibrationTime() const;
 
+        // getValue on a grid: points beyond the last pillar go through a single batched Svensson evaluation
+        std::vector<double> getValues(const std::vector<double>& timesToMaturity) const;
         double getShortRate() const;
         double getInstantaneousForwardRate(double t) const;
         double getDerivativeInstantaneousForwardRate(double t) const;
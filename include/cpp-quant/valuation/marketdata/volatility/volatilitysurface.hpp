@@ -0,0 +1,108 @@
+#pragma once
+#include <cmath>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "../../../../../include/cpp-quant/valuation/marketdata/marketdata.hpp"
+#include "cpp-math/optim.hpp"
+
+// Model references
+// A parsimonious arbitrage-free implied volatility parameterization - Gatheral (2004)
+// Quasi-explicit calibration of Gatheral's SVI model - Zeliade Systems (2009) : https://www.zeliade.com/wp-content/uploads/whitepapers/zwp-0005-SVICalibration.pdf
+// Arbitrage-free SVI volatility surfaces - Gatheral and Jacquier (2014) : https://doi.org/10.1080/14697688.2013.819986
+
+// Implied volatility surface stored as raw SVI slices in total variance w(k) = sigma^2*T with k = log(K/F)
+// SVI calibrates each expiry independently, SSVI calibrates (rho, eta, gamma) globally on the ATM total variance term structure, both are cached as raw SVI slices
+// Between expiries the total variance is interpolated linearly at fixed log-moneyness (calendar arbitrage free if the slices are), outside the implied volatility is held flat
+class VolatilitySurface final: public MarketData
+{
+    public:
+
+        enum class Parametrization {SVI, SSVI};
+
+        struct Quote
+        {
+            Quote(double forward, double strike, double maturity, double volatility);
+            double forward_;
+            double strike_;
+            double maturity_;
+            double volatility_;
+        };
+
+        // Raw SVI: w(k) = a + b*(rho*(k-m) + sqrt((k-m)^2 + sigma^2))
+        struct Slice
+        {
+            double a_;
+            double b_;
+            double rho_;
+            double m_;
+            double sigma_;
+
+            double getTotalVariance(double k) const;
+            double getFirstDerivative(double k) const;
+            double getSecondDerivative(double k) const;
+            // Durrleman density factor g(k), the slice is free of butterfly arbitrage where g(k) >= 0
+            double getDensityFactor(double k) const;
+        };
+
+        struct SSVIParameters
+        {
+            double rho_;
+            double eta_;
+            double gamma_;
+        };
+
+        struct ArbitrageReport
+        {
+            bool isArbitrageFree_;
+            int butterflyViolations_;
+            int calendarViolations_;
+            double worstDensityFactor_;
+            double worstCalendarSpread_;
+        };
+
+        VolatilitySurface(const DateTime& referenceTime, const std::vector<Quote>& quotes, const Parametrization& parametrization);
+        ~VolatilitySurface() = default;
+
+        double getVolatility(double K, double T) const;
+        double getTotalVariance(double k, double T) const;
+        double getForward(double T) const;
+        // Grid query, output[i*strikes.size() + j] is the volatility at (strikes[j], maturities[i])
+        std::vector<double> getVolatilities(const std::vector<double>& strikes, const std::vector<double>& maturities) const;
+
+        Parametrization getParametrization() const;
+        const std::vector<double>& getMaturities() const;
+        const std::vector<Slice>& getSlices() const;
+        SSVIParameters getSSVIParameters() const;
+        double getRootMeanSquaredError() const;
+        ArbitrageReport getArbitrageReport() const;
+
+    private:
+        static constexpr int ARBITRAGE_GRID_POINTS = 201;
+        static constexpr std::size_t MINIMUM_SVI_QUOTES = 5;
+
+        Parametrization parametrization_;
+        std::vector<double> maturities_;
+        std::vector<double> logForwards_;
+        std::vector<Slice> slices_;
+        SSVIParameters ssviParameters_;
+        double rootMeanSquaredError_;
+        double minimumLogMoneyness_;
+        double maximumLogMoneyness_;
+        ArbitrageReport arbitrageReport_;
+
+        // Slices are cached as (log-moneyness, total variance) pairs per expiry
+        typedef std::vector<std::pair<double, double>> SliceData;
+
+        static Slice getSVISlice(const SliceData& data);
+        static Slice getSVISlice(const SliceData& data, double m, double sigma, double& squaredError);
+        static Slice getSSVISlice(double theta, const SSVIParameters& parameters);
+        static double getATMTotalVariance(const SliceData& data);
+
+        std::size_t getUpperSliceIndex(double T) const;
+        double getLogForward(double T, std::size_t i) const;
+        double getVariance(double k, double T, std::size_t i) const;
+        void classSetter(const std::vector<Quote>& quotes);
+        void arbitrageReportSetter();
+};
@@ -27,6 +27,13 @@ namespace QuantErrorRegistry
                 }
             }
 
+            namespace VolatilitySurface
+            {
+                std::string EmptyVolatilityQuotesError::getErrorMessage() const {return "The volatility surface cannot be initialized with empty data. At least one quote is required.";}
+                std::string InvalidVolatilityQuoteError::getErrorMessage() const {return "The forward, strike, maturity and volatility of a quote must be strictly positive.";}
+                std::string InsufficientSliceQuotesError::getErrorMessage() const {return "An SVI slice requires at least five quotes per expiry.";}
+            }
+
         }
     }
 
@@ -1,4 +1,6 @@
 #include "../../include/cpp-quant/tools/black.hpp"
+#include "../../include/cpp-quant/tools/metrics.hpp"
+#include "../../include/cpp-quant/tools/vectormath.hpp"
 
 namespace BlackTools 
 {
@@ -18,58 +20,256 @@ namespace BlackTools
         const std::function<std::complex<double>(std::complex<double>)>& characteristicFunction, 
         GaussLaguerreQuadrature& gaussLaguerreQuadrature_)
     {
-        int n = gaussLaguerreQuadrature_.getPoints();
-        std::vector<double> laguerreNodes = gaussLaguerreQuadrature_.getRoots();
-        std::vector<double> laguerreWeights = gaussLaguerreQuadrature_.getWeights();
-        std::complex<double> i(0.0, 1.0);
+        QUANT_METRIC_INCREMENT(LEWIS_PRICES);
+        return LewisQuadraturePlan(gaussLaguerreQuadrature_).getUndiscountedPrice(x, isCall, characteristicFunction);
+    }
+
+    LewisQuadraturePlan::LewisQuadraturePlan(int points): points_(points)
+    {
+        GaussLaguerreQuadrature gaussLaguerreQuadrature_(points);
+        planSetter(gaussLaguerreQuadrature_.getRoots(), gaussLaguerreQuadrature_.getWeights());
+    }
+
+    LewisQuadraturePlan::LewisQuadraturePlan(GaussLaguerreQuadrature& gaussLaguerreQuadrature_): points_(gaussLaguerreQuadrature_.getPoints())
+    {
+        planSetter(gaussLaguerreQuadrature_.getRoots(), gaussLaguerreQuadrature_.getWeights());
+    }
+
+    int LewisQuadraturePlan::getPoints() const {return points_;}
+    const std::vector<double>& LewisQuadraturePlan::getNodes() const {return nodes_;}
+    const std::vector<double>& LewisQuadraturePlan::getCoefficients() const {return coefficients_;}
+
+    double LewisQuadraturePlan::getFoldedUndiscountedPrice(double x, bool isCall, const std::complex<double>* foldedValues) const
+    {
+        QUANT_METRIC_INCREMENT(LEWIS_PRICES);
         double sum = 0.0;
-        for (int j = 0; j < n; ++j) {
-            double u = laguerreNodes[j];
-            std::complex<double> integrand = std::exp(i * u * x) * characteristicFunction(std::complex<double>(u, -0.5));
-            double rintegrand = abs(integrand.real()) < DBL_MIN ? 0.0 : integrand.real();
-            if (rintegrand == 0.0 or abs(laguerreWeights[j])<1e-20) sum += 0.0;
-            else sum += laguerreWeights[j] * std::exp(u) * rintegrand / (u * u + 0.25);
+        const std::size_t n = nodes_.size();
+        #pragma omp simd reduction(+:sum)
+        for (std::size_t j = 0; j < n; ++j) sum += cos(nodes_[j]*x)*foldedValues[j].real() - sin(nodes_[j]*x)*foldedValues[j].imag();
+        double call = exp(x / 2.0) - sum / PI;
+        return isCall ? call : call - (exp(x / 2.0) - exp(-x / 2.0));
+    }
+
+    void LewisQuadraturePlan::planSetter(const std::vector<double>& roots, const std::vector<double>& weights)
+    {
+        nodes_.reserve(points_);
+        coefficients_.reserve(points_);
+        for (int j = 0; j < points_; ++j)
+        {
+            if (abs(weights[j])<1e-20) continue;
+            double u = roots[j];
+            nodes_.push_back(u);
+            coefficients_.push_back(weights[j] * std::exp(u) / (u * u + 0.25));
+        }
+    }
+
+    AdaptiveLewisQuadrature::AdaptiveLewisQuadrature(double tolerance, int minimumPoints, int maximumPoints):
+    tolerance_(tolerance), minimumPoints_(std::max(minimumPoints, 2)), maximumPoints_(std::max(maximumPoints, minimumPoints)){}
+    AdaptiveLewisQuadrature::AdaptiveLewisQuadrature(double tolerance): AdaptiveLewisQuadrature(tolerance, 8, 256){}
+
+    double AdaptiveLewisQuadrature::getTolerance() const {return tolerance_;}
+    int AdaptiveLewisQuadrature::getMinimumPoints() const {return minimumPoints_;}
+    int AdaptiveLewisQuadrature::getMaximumPoints() const {return maximumPoints_;}
+    std::size_t AdaptiveLewisQuadrature::getCachedOrders() const {std::lock_guard<std::mutex> lock(mutex_); return plans_.size();}
+
+    const LewisQuadraturePlan& AdaptiveLewisQuadrature::getPlan(int points) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = plans_.find(points);
+        if (it != plans_.end()) return it->second;
+        return plans_.emplace(points, LewisQuadraturePlan(points)).first->second;
+    }
+
+    COSEngine::COSEngine(int points, double truncationWidth): points_(points), truncationWidth_(truncationWidth){}
+    COSEngine::COSEngine(int points): points_(points), truncationWidth_(12.0){}
+
+    int COSEngine::getPoints() const {return points_;}
+    double COSEngine::getTruncationWidth() const {return truncationWidth_;}
+
+    std::pair<double, double> COSEngine::getTruncationRange(const std::vector<double>& x, const std::function<std::complex<double>(std::complex<double>)>& characteristicFunction) const
+    {
+        // Cumulants of X from the 5-point stencils of the cumulant generating function log(phi(u)) at u=0
+        const double h = 0.05;
+        std::complex<double> p1 = std::log(characteristicFunction(h)), m1 = std::log(characteristicFunction(-h));
+        std::complex<double> p2 = std::log(characteristicFunction(2*h)), m2 = std::log(characteristicFunction(-2*h));
+        double c1 = ((m2 - 8.0*m1 + 8.0*p1 - p2)/(12*h)).imag();
+        double c2 = -((-p2 + 16.0*p1 + 16.0*m1 - m2)/(12*h*h)).real();
+        double c4 = ((p2 - 4.0*p1 - 4.0*m1 + m2)/(h*h*h*h)).real();
+        double width = truncationWidth_*sqrt(fabs(c2) + sqrt(fabs(c4)));
+        double xMin = *std::min_element(x.begin(), x.end()), xMax = *std::max_element(x.begin(), x.end());
+        return {xMin + c1 - width, xMax + c1 + width};
+    }
+
+    std::vector<double> COSEngine::getUndiscountedPrices(const std::vector<double>& x, bool isCall, const std::function<std::complex<double>(std::complex<double>)>& characteristicFunction) const
+    {
+        std::vector<double> prices(x.size());
+        if (x.empty()) return prices;
+        auto [a, b] = getTruncationRange(x, characteristicFunction);
+        const double bma = b - a, d = std::min(std::max(0.0, a), b);
+
+        // Put payoff (1-e^y)^+ coefficients on [a, min(0,b)] folded with the characteristic function, the first term is halved
+        std::vector<double> u(points_);
+        std::vector<std::complex<double>> foldedValues(points_);
+        for (int k = 0; k < points_; ++k)
+        {
+            u[k] = k*PI/bma;
+            double cosd = cos(u[k]*(d - a)), sind = sin(u[k]*(d - a));
+            double chi = (cosd*exp(d) - exp(a) + u[k]*sind*exp(d))/(1 + u[k]*u[k]);
+            double psi = (k == 0) ? d - a : sind/u[k];
+            foldedValues[k] = (k == 0 ? 0.5 : 1.0) * (2.0/bma) * (psi - chi) * characteristicFunction(u[k]);
+        }
+        for (std::size_t j = 0; j < x.size(); ++j)
+        {
+            double sum = 0.0, shift = x[j] - a;
+            for (int k = 0; k < points_; ++k) sum += cos(u[k]*shift)*foldedValues[k].real() - sin(u[k]*shift)*foldedValues[k].imag();
+            double put = exp(-.5*x[j])*sum;
+            prices[j] = isCall ? put + exp(.5*x[j]) - exp(-.5*x[j]) : put;
         }
-        double call = std::exp(x / 2.0) - sum / M_PI;
-        return isCall ? call : call - getNormalizedIntrisicValue(x, true);
+        return prices;
+    }
+
+    // In-place iterative radix-2 FFT (size is a power of two)
+    static void getFastFourierTransform(std::vector<std::complex<double>>& values)
+    {
+        const std::size_t n = values.size();
+        for (std::size_t i = 1, j = 0; i < n; ++i)
+        {
+            std::size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) std::swap(values[i], values[j]);
+        }
+        for (std::size_t length = 2; length <= n; length <<= 1)
+        {
+            std::complex<double> root = std::polar(1.0, -2*PI/length);
+            for (std::size_t i = 0; i < n; i += length)
+            {
+                std::complex<double> w(1.0, 0.0);
+                for (std::size_t k = 0; k < length/2; ++k)
+                {
+                    std::complex<double> even = values[i+k], odd = values[i+k+length/2]*w;
+                    values[i+k] = even + odd;
+                    values[i+k+length/2] = even - odd;
+                    w *= root;
+                }
+            }
+        }
+    }
+
+    static int getNextPowerOfTwo(int n){int p = 1; while (p < n) p <<= 1; return p;}
+
+    CarrMadanEngine::CarrMadanEngine(int points, double gridSpacing, double dampingFactor): 
+    points_(getNextPowerOfTwo(points)), gridSpacing_(gridSpacing), dampingFactor_(dampingFactor){}
+    CarrMadanEngine::CarrMadanEngine(int points): points_(getNextPowerOfTwo(points)), gridSpacing_(0.25), dampingFactor_(1.5){}
+
+    int CarrMadanEngine::getPoints() const {return points_;}
+
+    std::vector<double> CarrMadanEngine::getUndiscountedPrices(const std::vector<double>& x, bool isCall, const std::function<std::complex<double>(std::complex<double>)>& characteristicFunction) const
+    {
+        // Call prices C/F on the log-strike grid k_m = -b + lambda*m, k = log(K/F) = -x
+        const double eta = gridSpacing_, alpha = dampingFactor_, lambda = 2*PI/(points_*eta), b = .5*points_*lambda;
+        const std::complex<double> i(0.0, 1.0);
+        std::vector<std::complex<double>> values(points_);
+        for (int j = 0; j < points_; ++j)
+        {
+            double v = j*eta;
+            double simpson = (j == 0) ? 1.0/3.0 : ((j % 2 == 1) ? 4.0/3.0 : 2.0/3.0);
+            std::complex<double> psi = characteristicFunction(v - (alpha + 1)*i)/(alpha*alpha + alpha - v*v + i*(2*alpha + 1)*v);
+            values[j] = std::exp(i*b*v)*psi*eta*simpson;
+        }
+        getFastFourierTransform(values);
+
+        std::vector<double> prices(x.size());
+        for (std::size_t j = 0; j < x.size(); ++j)
+        {
+            // Cubic Lagrange interpolation of C/F on the four surrounding grid points
+            double position = (-x[j] + b)/lambda;
+            int m = std::min(std::max(static_cast<int>(floor(position)) - 1, 0), points_ - 4);
+            double call = 0.0;
+            for (int p = 0; p < 4; ++p)
+            {
+                double k = -b + lambda*(m + p), weight = 1.0;
+                for (int q = 0; q < 4; ++q) if (q != p) weight *= (position - (m + q))/(p - q);
+                call += weight*exp(-alpha*k)*values[m + p].real()/PI;
+            }
+            // C/sqrt(FK) = (C/F)*exp(x/2)
+            call *= exp(.5*x[j]);
+            prices[j] = isCall ? call : call - (exp(.5*x[j]) - exp(-.5*x[j]));
+        }
+        return prices;
     }
 
 }
 
 namespace UndiscountedBlack
 {
-    double getCallPriceRegion1(double h, double t)
+    // Series of the regions 1 and 2 without their Gaussian factor (and t/r in region 1), shared by the scalar and the batch kernels
+    static QUANT_VECTOR_INLINE double getCallPriceRegion1Expansion(double h, double t)
     {
         const double e=(t/h)*(t/h), r=((h+t)*(h-t)), q=(h/r)*(h/r);
         const double asymptotic_expansion_sum = (2.0+q*(-6.0E0-2.0*e+3.0*q*(1.0E1+e*(2.0E1+2.0*e)+5.0*q*(-1.4E1+e*(-7.0E1+e*(-4.2E1-2.0*e))+7.0*q*(1.8E1+e*(1.68E2+e*(2.52E2+e*(7.2E1+2.0*e)))+9.0*q*(-2.2E1+e*(-3.3E2+e*(-9.24E2+e*(-6.6E2+e*(-1.1E2-2.0*e))))+1.1E1*q*(2.6E1+e*(5.72E2+e*(2.574E3+e*(3.432E3+e*(1.43E3+e*(1.56E2+2.0*e)))))+1.3E1*q*(-3.0E1+e*(-9.1E2+e*(-6.006E3+e*(-1.287E4+e*(-1.001E4+e*(-2.73E3+e*(-2.1E2-2.0*e))))))+1.5E1*q*(3.4E1+e*(1.36E3+e*(1.2376E4+e*(3.8896E4+e*(4.862E4+e*(2.4752E4+e*(4.76E3+e*(2.72E2+2.0*e)))))))+1.7E1*q*(-3.8E1+e*(-1.938E3+e*(-2.3256E4+e*(-1.00776E5+e*(-1.84756E5+e*(-1.51164E5+e*(-5.4264E4+e*(-7.752E3+e*(-3.42E2-2.0*e))))))))+1.9E1*q*(4.2E1+e*(2.66E3+e*(4.0698E4+e*(2.3256E5+e*(5.8786E5+e*(7.05432E5+e*(4.0698E5+e*(1.08528E5+e*(1.197E4+e*(4.2E2+2.0*e)))))))))+2.1E1*q*(-4.6E1+e*(-3.542E3+e*(-6.7298E4+e*(-4.90314E5+e*(-1.63438E6+e*(-2.704156E6+e*(-2.288132E6+e*(-9.80628E5+e*(-2.01894E5+e*(-1.771E4+e*(-5.06E2-2.0*e))))))))))+2.3E1*q*(5.0E1+e*(4.6E3+e*(1.0626E5+e*(9.614E5+e*(4.08595E6+e*(8.9148E6+e*(1.04006E7+e*(6.53752E6+e*(2.16315E6+e*(3.542E5+e*(2.53E4+e*(6.0E2+2.0*e)))))))))))+2.5E1*q*(-5.4E1+e*(-5.85E3+e*(-1.6146E5+e*(-1.77606E6+e*(-9.37365E6+e*(-2.607579E7+e*(-4.01166E7+e*(-3.476772E7+e*(-1.687257E7+e*(-4.44015E6+e*(-5.9202E5+e*(-3.51E4+e*(-7.02E2-2.0*e))))))))))))+2.7E1*q*(5.8E1+e*(7.308E3+e*(2.3751E5+e*(3.12156E6+e*(2.003001E7+e*(6.919458E7+e*(1.3572783E8+e*(1.5511752E8+e*(1.0379187E8+e*(4.006002E7+e*(8.58429E6+e*(9.5004E5+e*(4.7502E4+e*(8.12E2+2.0*e)))))))))))))+2.9E1*q*(-6.2E1+e*(-8.99E3+e*(-3.39822E5+e*(-5.25915E6+e*(-4.032015E7+e*(-1.6934463E8+e*(-4.1250615E8+e*(-6.0108039E8+e*(-5.3036505E8+e*(-2.8224105E8+e*(-8.870433E7+e*(-1.577745E7+e*(-1.472562E6+e*(-6.293E4+e*(-9.3E2-2.0*e))))))))))))))+3.1E1*q*(6.6E1+e*(1.0912E4+e*(4.74672E5+e*(8.544096E6+e*(7.71342E7+e*(3.8707344E8+e*(1.14633288E9+e*(2.07431664E9+e*(2.33360622E9+e*(1.6376184E9+e*(7.0963464E8+e*(1.8512208E8+e*(2.7768312E7+e*(2.215136E6+e*(8.184E4+e*(1.056E3+2.0*e)))))))))))))))+3.3E1*(-7.0E1+e*(-1.309E4+e*(-6.49264E5+e*(-1.344904E7+e*(-1.4121492E8+e*(-8.344518E8+e*(-2.9526756E9+e*(-6.49588632E9+e*(-9.0751353E9+e*(-8.1198579E9+e*(-4.6399188E9+e*(-1.6689036E9+e*(-3.67158792E8+e*(-4.707164E7+e*(-3.24632E6+e*(-1.0472E5+e*(-1.19E3-2.0*e)))))))))))))))))*q)))))))))))))))));
-        return BlackTools::ONE_OVER_SQRT_TWO_PI*exp((-0.5*(h*h+t*t)))*(t/r)*asymptotic_expansion_sum;
+        return asymptotic_expansion_sum;
+    }
+
+    static QUANT_VECTOR_INLINE double getCallPriceRegion2Expansion(double a, double h, double t)
+    {
+        const double w=t*t, h2=h*h;
+        return 2*t*(a+w*((-1+3*a+a*h2)/6+w*((-7+15*a+h2*(-1+10*a+a*h2))/120+w*((-57+105*a+h2*(-18+105*a+h2*(-1+21*a+a*h2)))/5040+w*((-561+945*a+h2*(-285+1260*a+h2*(-33+378*a+h2*(-1+36*a+a*h2))))/362880+w*((-6555+10395*a+h2*(-4680+17325*a+h2*(-840+6930*a+h2*(-52+990*a+h2*(-1+55*a+a*h2)))))/39916800+((-89055+135135*a+h2*(-82845+270270*a+h2*(-20370+135135*a+h2*(-1926+25740*a+h2*(-75+2145*a+h2*(-1+78*a+a*h2))))))*w)/6227020800.0))))));
+    }
+
+    double getCallPriceRegion1(double h, double t)
+    {
+        return BlackTools::ONE_OVER_SQRT_TWO_PI*exp((-0.5*(h*h+t*t)))*(t/((h+t)*(h-t)))*getCallPriceRegion1Expansion(h, t);
     }
 
     double getCallPriceRegion2(double h, double t)
     {
-        const double a = 1+h*(0.5*BlackTools::SQRT_TWO_PI)*GaussianTool::erfcxCody(-BlackTools::ONE_OVER_SQRT_TWO*h), w=t*t, h2=h*h;
-        const double expansion = 2*t*(a+w*((-1+3*a+a*h2)/6+w*((-7+15*a+h2*(-1+10*a+a*h2))/120+w*((-57+105*a+h2*(-18+105*a+h2*(-1+21*a+a*h2)))/5040+w*((-561+945*a+h2*(-285+1260*a+h2*(-33+378*a+h2*(-1+36*a+a*h2))))/362880+w*((-6555+10395*a+h2*(-4680+17325*a+h2*(-840+6930*a+h2*(-52+990*a+h2*(-1+55*a+a*h2)))))/39916800+((-89055+135135*a+h2*(-82845+270270*a+h2*(-20370+135135*a+h2*(-1926+25740*a+h2*(-75+2145*a+h2*(-1+78*a+a*h2))))))*w)/6227020800.0))))));
-        return BlackTools::ONE_OVER_SQRT_TWO_PI*exp((-0.5*(h*h+t*t)))*expansion;
+        const double a = 1+h*(0.5*BlackTools::SQRT_TWO_PI)*NormalDistribution::getErfcx(-BlackTools::ONE_OVER_SQRT_TWO*h);
+        return BlackTools::ONE_OVER_SQRT_TWO_PI*exp((-0.5*(h*h+t*t)))*getCallPriceRegion2Expansion(a, h, t);
     } 
 
     double getCallPriceRegion3(double h, double t)
     {
-        Gaussian norm = Gaussian();
-        return norm.cdf(h+t)*exp(h*t) - norm.cdf(h-t)/exp(h*t);
+        return NormalDistribution::getCdf(h+t)*exp(h*t) - NormalDistribution::getCdf(h-t)/exp(h*t);
     }
 
     double getCallPriceRegion4(double h, double t)
     {
-        return 0.5 * exp(-0.5*(h*h+t*t)) * (GaussianTool::erfcxCody(-BlackTools::ONE_OVER_SQRT_TWO*(h+t)) - GaussianTool::erfcxCody(-BlackTools::ONE_OVER_SQRT_TWO*(h-t)));
+        return 0.5 * exp(-0.5*(h*h+t*t)) * (NormalDistribution::getErfcx(-BlackTools::ONE_OVER_SQRT_TWO*(h+t)) - NormalDistribution::getErfcx(-BlackTools::ONE_OVER_SQRT_TWO*(h-t)));
+    }
+
+    // Branch-free region kernels of the batch pricer: same formulas with the VectorMath exp, erfcx and cdf in place of libm (a few
+    // ulps apart from the scalar kernels), they inline into the region loops of getPrices which the compiler then vectorizes
+    static QUANT_VECTOR_INLINE double getVectorCallPriceRegion1(double h, double t)
+    {
+        return BlackTools::ONE_OVER_SQRT_TWO_PI*VectorMath::getExp(-0.5*(h*h+t*t))*(t/((h+t)*(h-t)))*getCallPriceRegion1Expansion(h, t);
+    }
+
+    static QUANT_VECTOR_INLINE double getVectorCallPriceRegion2(double h, double t)
+    {
+        const double a = 1+h*(0.5*BlackTools::SQRT_TWO_PI)*VectorMath::getErfcx(-BlackTools::ONE_OVER_SQRT_TWO*h);
+        return BlackTools::ONE_OVER_SQRT_TWO_PI*VectorMath::getExp(-0.5*(h*h+t*t))*getCallPriceRegion2Expansion(a, h, t);
+    }
+
+    static QUANT_VECTOR_INLINE double getVectorCallPriceRegion3(double h, double t)
+    {
+        const double e = VectorMath::getExp(h*t);
+        return VectorMath::getCdf(h+t)*e - VectorMath::getCdf(h-t)/e;
+    }
+
+    static QUANT_VECTOR_INLINE double getVectorCallPriceRegion4(double h, double t)
+    {
+        return 0.5*VectorMath::getExp(-0.5*(h*h+t*t))*(VectorMath::getErfcx(-BlackTools::ONE_OVER_SQRT_TWO*(h+t)) - VectorMath::getErfcx(-BlackTools::ONE_OVER_SQRT_TWO*(h-t)));
     }
 
     double getCallPrice(double x, double normalizedSigma)
     {
         if (x>0) return BlackTools::getNormalizedIntrisicValue(x, true)+getCallPrice(-x,normalizedSigma);
         if (normalizedSigma<=0) return BlackTools::getNormalizedIntrisicValue(x, true);
-        if ( x < normalizedSigma*BlackTools::H_LARGE  &&  0.5*normalizedSigma*normalizedSigma+x < normalizedSigma*(BlackTools::T_SMALL+BlackTools::H_LARGE)) return getCallPriceRegion1(x/normalizedSigma, .5*normalizedSigma);
-        if ( 0.5*normalizedSigma < BlackTools::T_SMALL) return getCallPriceRegion2(x/normalizedSigma, .5*normalizedSigma);
-        if (x+0.5*normalizedSigma*normalizedSigma > normalizedSigma*0.85) return getCallPriceRegion3(x/normalizedSigma, .5*normalizedSigma);
+        if ( x < normalizedSigma*BlackTools::H_LARGE  &&  0.5*normalizedSigma*normalizedSigma+x < normalizedSigma*(BlackTools::T_SMALL+BlackTools::H_LARGE)) {QUANT_METRIC_INCREMENT(BLACK_REGION1); return getCallPriceRegion1(x/normalizedSigma, .5*normalizedSigma);}
+        if ( 0.5*normalizedSigma < BlackTools::T_SMALL) {QUANT_METRIC_INCREMENT(BLACK_REGION2); return getCallPriceRegion2(x/normalizedSigma, .5*normalizedSigma);}
+        if (x+0.5*normalizedSigma*normalizedSigma > normalizedSigma*0.85) {QUANT_METRIC_INCREMENT(BLACK_REGION3); return getCallPriceRegion3(x/normalizedSigma, .5*normalizedSigma);}
+        QUANT_METRIC_INCREMENT(BLACK_REGION4);
         return getCallPriceRegion4(x/normalizedSigma, .5*normalizedSigma);
     }
 
@@ -92,6 +292,97 @@ namespace UndiscountedBlack
         return getCallPrice(x,normalizedSigma);
     }
 
+    void getPrices(const double* x, const double* normalizedSigma, const bool* isCall, std::size_t n, double* prices)
+    {
+        // Partition buffers live on the stack, one block of points is classified then priced region by region
+        constexpr std::size_t blockSize = 256;
+        std::size_t index[4][blockSize], count[4];
+        double h[4][blockSize], t[4][blockSize], regionPrice[4][blockSize], intrinsic[blockSize];
+        for (std::size_t start = 0; start < n; start += blockSize)
+        {
+            const std::size_t m = std::min(blockSize, n - start);
+            count[0] = count[1] = count[2] = count[3] = 0;
+            for (std::size_t j = 0; j < m; ++j)
+            {
+                double s = normalizedSigma[start+j], xc = isCall[start+j] ? x[start+j] : -x[start+j];
+                intrinsic[j] = BlackTools::getNormalizedIntrisicValue(xc, true);
+                prices[start+j] = intrinsic[j];
+                if (s<=DBL_MIN) continue;
+                // Same region boundaries as getCallPrice, applied to the out-of-the-money side
+                double xo = -fabs(xc);
+                int region;
+                if (xo < s*BlackTools::H_LARGE && 0.5*s*s+xo < s*(BlackTools::T_SMALL+BlackTools::H_LARGE)) region = 0;
+                else if (0.5*s < BlackTools::T_SMALL) region = 1;
+                else if (xo+0.5*s*s > s*0.85) region = 2;
+                else region = 3;
+                std::size_t k = count[region]++;
+                index[region][k] = j; 
+                h[region][k] = xo/s; 
+                t[region][k] = .5*s;
+            }
+            QUANT_METRIC_ADD(BLACK_REGION1, count[0]);
+            QUANT_METRIC_ADD(BLACK_REGION2, count[1]);
+            QUANT_METRIC_ADD(BLACK_REGION3, count[2]);
+            QUANT_METRIC_ADD(BLACK_REGION4, count[3]);
+
+            #pragma omp simd
+            for (std::size_t k = 0; k < count[0]; ++k) regionPrice[0][k] = getVectorCallPriceRegion1(h[0][k], t[0][k]);
+            #pragma omp simd
+            for (std::size_t k = 0; k < count[1]; ++k) regionPrice[1][k] = getVectorCallPriceRegion2(h[1][k], t[1][k]);
+            #pragma omp simd
+            for (std::size_t k = 0; k < count[2]; ++k) regionPrice[2][k] = getVectorCallPriceRegion3(h[2][k], t[2][k]);
+            #pragma omp simd
+            for (std::size_t k = 0; k < count[3]; ++k) regionPrice[3][k] = getVectorCallPriceRegion4(h[3][k], t[3][k]);
+
+            for (int r = 0; r < 4; ++r) 
+                for (std::size_t k = 0; k < count[r]; ++k) prices[start+index[r][k]] = intrinsic[index[r][k]] + regionPrice[r][k];
+        }
+    }
+
+    // Price and Greeks from d1, d2, n(d1) and N(w.d1), N(w.d2) with w = +1 for a call and -1 for a put (no cancellation in the put delta)
+    Greeks getGreeks(double F, double K, double T, double sigma, bool isCall)
+    {
+        Greeks greeks;
+        const double w = isCall ? 1.0 : -1.0;
+        const double sqrtT = sqrt(T), s = sigma*sqrtT;
+        if (s<=DBL_MIN)
+        {
+            // Limit of the intrinsic value, at the money N(d1) -> 1/2 on both sides
+            greeks.price_ = std::max(w*(F - K), 0.0);
+            greeks.delta_ = F == K ? .5*w : (w*(F - K) > 0.0 ? w : 0.0);
+            greeks.gamma_ = greeks.vega_ = greeks.theta_ = greeks.vanna_ = greeks.volga_ = greeks.charm_ = greeks.veta_ = 0.0;
+            return greeks;
+        }
+        const double d1 = log(F/K)/s + .5*s, d2 = d1 - s;
+        const double pdf = BlackTools::ONE_OVER_SQRT_TWO_PI*exp(-.5*d1*d1);
+        const double cdf1 = NormalDistribution::getCdf(w*d1), cdf2 = NormalDistribution::getCdf(w*d2);
+        const double vega = F*pdf*sqrtT;
+        greeks.price_ = std::max(w*(F*cdf1 - K*cdf2), 0.0);
+        greeks.delta_ = w*cdf1;
+        greeks.gamma_ = pdf/(F*s);
+        greeks.vega_ = vega;
+        greeks.vanna_ = -pdf*d2/sigma;
+        greeks.volga_ = vega*d1*d2/sigma;
+        // Calendar time derivatives -d/dT
+        greeks.theta_ = -.5*F*pdf*sigma/sqrtT;
+        greeks.charm_ = pdf*d2/(2*T);
+        greeks.veta_ = -.5*F*pdf*(1 + d1*d2)/sqrtT;
+        return greeks;
+    }
+
+    void getGreeks(const double* F, const double* K, const double* T, const double* sigma, const bool* isCall, std::size_t n, GreeksArrays& greeks)
+    {
+        for (std::vector<double>* output: {&greeks.price_, &greeks.delta_, &greeks.gamma_, &greeks.vega_, &greeks.theta_, &greeks.vanna_, &greeks.volga_, &greeks.charm_, &greeks.veta_}) 
+            output->resize(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            Greeks g = getGreeks(F[i], K[i], T[i], sigma[i], isCall[i]);
+            greeks.price_[i] = g.price_; greeks.delta_[i] = g.delta_; greeks.gamma_[i] = g.gamma_; 
+            greeks.vega_[i] = g.vega_; greeks.theta_[i] = g.theta_; greeks.vanna_[i] = g.vanna_; 
+            greeks.volga_[i] = g.volga_; greeks.charm_[i] = g.charm_; greeks.veta_[i] = g.veta_;
+        }
+    }
+
     std::complex<double> getCharacteristicFunction(std::complex<double> u, double x, double normalizedSigma)
     {
         return std::exp(-0.5*u*(u+std::complex<double>(0.0,1.0))*normalizedSigma*normalizedSigma);
@@ -105,6 +396,13 @@ namespace UndiscountedBlack
         return BlackTools::getLewisUndiscountedPrice(x, isCall, cf, gaussLaguerreQuadrature_);
     }
 
+    double getLewisPrice(double x, double normalizedSigma, bool isCall, const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan)
+    {
+        return lewisQuadraturePlan.getUndiscountedPrice(x, isCall, [normalizedSigma, x](std::complex<double> u) {
+            return getCharacteristicFunction(u, x, normalizedSigma);
+        });
+    }
+
 }
 
 namespace ImpliedVolatilitySolver
@@ -125,10 +423,28 @@ namespace ImpliedVolatilitySolver
         return numerator / denominator;
     }
 
+    double getMinimumR(double dl, double dr, double s, bool preferShapePreservation)
+    {
+        // Smallest control parameter keeping the rational cubic monotone/convex where the data is (Jäckel, Let's be rational, section 5)
+        const bool monotonic = dl*s >= 0 && dr*s >= 0, convex = dl <= s && s <= dr, concave = dl >= s && s >= dr;
+        if (!monotonic && !convex && !concave) return minR;
+        double r1 = -DBL_MAX, r2 = -DBL_MAX;
+        if (monotonic) {
+            if (fabs(s) > 0) r1 = (dr + dl)/s;
+            else if (preferShapePreservation) r1 = maxR;
+        }
+        if (convex || concave) {
+            if (fabs(s - dl) > 0 && fabs(dr - s) > 0) r2 = std::max(fabs((dr - dl)/(dr - s)), fabs((dr - dl)/(s - dl)));
+            else if (preferShapePreservation) r2 = maxR;
+        }
+        else if (monotonic && preferShapePreservation) r2 = maxR;
+        return std::max(minR, std::max(r1, r2));
+    }
+
     namespace RightAsymptotic
     {
 
-        double get(double sigma){return Gaussian().cdf(-sigma/2);}
+        double get(double sigma){return NormalDistribution::getCdf(-sigma/2);}
 
         double getFirstDerivative(double x, double sigma){return (abs(x)<DBL_MIN) ? -.5 : -.5 * exp(.5*x*x/(sigma*sigma));}
 
@@ -163,22 +479,22 @@ namespace ImpliedVolatilitySolver
 
         double get(double x, double sigma)
         {
-            double cdfz = Gaussian().cdf(getZ(x, sigma));
+            double cdfz = NormalDistribution::getCdf(getZ(x, sigma));
             return (2*BlackTools::PI*cdfz*cdfz*cdfz*abs(x))/(3*sqrt(3));
         }
         
         double getFirstDerivative(double x, double sigma)
         {
             double z = getZ(x, sigma);
-            double cdfz = Gaussian().cdf(z);
+            double cdfz = NormalDistribution::getCdf(z);
             return 2*BlackTools::PI*z*z*cdfz*cdfz*exp(z*z+sigma*sigma/8.0);
             }
         
         double getSecondDerivative(double x, double sigma)
         {
             double z = getZ(x, sigma);
-            double cdfz = Gaussian().cdf(z);
-            double pdfz = Gaussian().pdf(z);
+            double cdfz = NormalDistribution::getCdf(z);
+            double pdfz = NormalDistribution::getPdf(z);
             double sigmasq = sigma*sigma;
             double term1 = (BlackTools::PI/6)*(z*z/(sigmasq*sigma))*cdfz*exp(2*z*z+sigmasq/4.0);
             double term2 = 8*sqrt(3)*sigma*abs(x)+(3*sigmasq*(sigmasq-8)-8*x*x)*cdfz/pdfz;
@@ -189,7 +505,7 @@ namespace ImpliedVolatilitySolver
         
     }
 
-    std::tuple<double, double, double, double, double, double, double, double, double, double, bool> getInitialData(double beta, double x, double isCall)
+    InitialData getInitialData(double beta, double x, double isCall)
     {
         int c = isCall ? 1 : -1;
         if (c*x>0){
@@ -210,33 +526,38 @@ namespace ImpliedVolatilitySolver
 
     double getInitialGuess(double beta, double x, bool isCall)
     {
-        auto [beta_,x_,b_max,sigma_l, sigma_c, sigma_u, b_l, b_c, b_u, v_c, is_call_] = getInitialData(beta, x, isCall);
+        return getInitialGuess(getInitialData(beta, x, isCall));
+    }
+
+    double getInitialGuess(const InitialData& data)
+    {
+        auto [beta_,x_,b_max,sigma_l, sigma_c, sigma_u, b_l, b_c, b_u, v_c, is_call_] = data;
         if (beta_ < b_l && beta_ >= 0) {
             double fl = LeftAsymptotic::get(x_, sigma_l);
             double dfl = LeftAsymptotic::getFirstDerivative(x_, sigma_l);
             double ddfl = LeftAsymptotic::getSecondDerivative(x_, sigma_l);
-            double r = LeftAsymptotic::getR(0, b_l, 0, fl, 1, dfl, ddfl);
+            double r = std::max(LeftAsymptotic::getR(0, b_l, 0, fl, 1, dfl, ddfl), getMinimumR(1, dfl, fl/b_l, true));
             double frc = getRationalCubicInterpolate(beta_, 0, b_l, 0, fl, 1, dfl, r);
             double sq3 = sqrt(3), a = frc/(2*BlackTools::PI*abs(x_));
-            return abs(x_/(sq3*Gaussian().quantile(sq3*std::pow(a, 1.0/3.0))));
+            return abs(x_/(sq3*NormalDistribution::getQuantile(sq3*std::pow(a, 1.0/3.0))));
         }
         else if (beta_ <= b_c && beta_ >= b_l){
             double v_l = UndiscountedBlack::getVega(x_, sigma_l);
-            double r = LeftAsymptotic::getR(b_l, b_c, sigma_l, sigma_c, 1/v_l, 1/v_c, 0);
+            double r = std::max(LeftAsymptotic::getR(b_l, b_c, sigma_l, sigma_c, 1/v_l, 1/v_c, 0), getMinimumR(1/v_l, 1/v_c, (sigma_c - sigma_l)/(b_c - b_l), false));
             return getRationalCubicInterpolate(beta_, b_l, b_c, sigma_l, sigma_c, 1/v_l, 1/v_c, r);
         }
         else if (beta_ <= b_u && beta_ > b_c){
             double v_u = UndiscountedBlack::getVega(x_, sigma_u);
-            double r = RightAsymptotic::getR(b_c, b_u, sigma_c, sigma_u, 1/v_c, 1/v_u, 0);
+            double r = std::max(RightAsymptotic::getR(b_c, b_u, sigma_c, sigma_u, 1/v_c, 1/v_u, 0), getMinimumR(1/v_c, 1/v_u, (sigma_u - sigma_c)/(b_u - b_c), false));
             return getRationalCubicInterpolate(beta_, b_c, b_u, sigma_c, sigma_u, 1/v_c, 1/v_u, r);
         }
         else {
             double fu = RightAsymptotic::get(sigma_u);
             double dfu = RightAsymptotic::getFirstDerivative(x_, sigma_u);
             double ddfu = RightAsymptotic::getSecondDerivative(x_, sigma_u);
-            double r = RightAsymptotic::getR(b_u, b_max, fu, 0, dfu, -.5, ddfu);
+            double r = std::max(RightAsymptotic::getR(b_u, b_max, fu, 0, dfu, -.5, ddfu), getMinimumR(dfu, -.5, -fu/(b_max - b_u), true));
             double frc = getRationalCubicInterpolate(beta_, b_u, b_max, fu, 0, dfu, -.5, r);
-            return -2.0*Gaussian().quantile(frc);
+            return -2.0*NormalDistribution::getQuantile(frc);
         }
     } 
 
@@ -258,34 +579,364 @@ namespace ImpliedVolatilitySolver
         else return [bMax, x](double s) {return UndiscountedBlack::getVega(x, s)/(bMax - UndiscountedBlack::getCallPrice(x, s));};
     }
 
+    // Newton iteration on the targets of getTarget/getTargetFirstDerivative evaluated in place (no std::function nor NewtonRaphson object),
+    // shared by the scalar and batch solvers so that both stop on the same rule: |f| < 1e-20, a step below the resolution of the iterate,
+    // or a tiny step that no longer contracts (the iteration reached the rounding noise of the price, |f| cannot always get to 1e-20 in
+    // double precision and the last iterates cycle a few ulps apart). NaN when none happens within 100 iterations.
+    static inline double getInlineNewtonNormalizedVolatility(double beta, double x, bool isCall)
+    {
+        const InitialData data = getInitialData(beta, x, isCall);
+        auto [beta_,x_,b_max,sigma_l, sigma_c, sigma_u, b_l, b_c, b_u, v_c, is_call_] = data;
+        if (beta_<=0) return 0.0;
+        const int branch = (beta_ < b_l) ? 0 : (beta_ <= std::max(b_u, b_max/2) ? 1 : 2);
+        double s = getInitialGuess(data);
+        bool converged = false;
+        double previousStep = INFINITY;
+        int k = 0;
+        for (; k < 100; ++k)
+        {
+            double b = UndiscountedBlack::getCallPrice(x_, s), v = UndiscountedBlack::getVega(x_, s), f, df;
+            switch (branch)
+            {
+                case 0: f = log(1/b) - log(1/beta_); df = -v/b; break;
+                case 1: f = b - beta_; df = v; break;
+                default: f = log((b_max-beta_)/(b_max-b)); df = v/(b_max-b); break;
+            }
+            if (fabs(f) < 1e-20) {converged = true; break;}
+            double step = f/df;
+            s -= step;
+            if (std::isnan(s)) break;
+            if (fabs(step) <= DBL_EPSILON*fabs(s) or (fabs(step) >= fabs(previousStep) and fabs(step) <= 1e-8*fabs(s))) {converged = true; break;}
+            previousStep = step;
+        }
+        QUANT_METRIC_RECORD(IMPLIED_VOLATILITY_ITERATIONS, k + 1);
+        return converged ? s : NAN;
+    }
+
     double getNewtonNormalizedVolatility(double beta, double x, bool isCall)
     {
-        auto [beta_,x_,b_max,sigma_l, sigma_c, sigma_u, b_l, b_c, b_u, v_c, is_call_] = getInitialData(beta, x, isCall);
+        return getInlineNewtonNormalizedVolatility(beta, x, isCall);
+    }
+
+    double getHouseholderNormalizedVolatility(double beta, double x, bool isCall)
+    {
+        const InitialData data = getInitialData(beta, x, isCall);
+        auto [beta_,x_,b_max,sigma_l, sigma_c, sigma_u, b_l, b_c, b_u, v_c, is_call_] = data;
         if (beta_<=0) return 0.0;
-        NewtonRaphson newton(
-            getInitialGuess(beta, x, isCall),
-            getTarget(beta_, x_, b_l, b_u),
-            getTargetFirstDerivative(beta_, x_, b_l, b_u)
-        );
-        newton.setToleranceThreshold(1e-20);
-        newton.setMaximumIterations(100);
-        newton.optimize(); 
-        if (!newton.getError()) return newton.getResult();
-        else return NAN;
+        const int branch = (beta_ < b_l) ? 0 : (beta_ <= std::max(b_u, b_max/2) ? 1 : 2);
+        double s = getInitialGuess(data);
+        for (int k = 0; k < HOUSEHOLDER_ITERATIONS; ++k)
+        {
+            // g = b''/b' and h = b'''/b' are closed-form in the normalized Black model
+            double b = UndiscountedBlack::getCallPrice(x_, s), v = UndiscountedBlack::getVega(x_, s);
+            double g = x_*x_/(s*s*s) - .25*s, h = g*g - 3*x_*x_/(s*s*s*s) - .25; 
+            double nu, gamma, delta; // -f/f', f''/f' and f'''/f' of the target of getTarget
+            switch (branch)
+            {
+                case 0: {double l = v/b; nu = (log(beta_) - log(b))/l; gamma = g - l; delta = h - 3*g*l + 2*l*l; break;}
+                case 1: {nu = (beta_ - b)/v; gamma = g; delta = h; break;}
+                default: {double m = v/(b_max - b); nu = -log((b_max-beta_)/(b_max-b))/m; gamma = g + m; delta = h + 3*g*m + 2*m*m; break;}
+            }
+            s += nu*(1 + .5*gamma*nu)/(1 + nu*(gamma + delta*nu/6));
+        }
+        return s;
+    }
+
+    double getBlackImpliedVolatility(double undiscountedPrice, double F, double K, double timeToMaturity, bool isCall, const SolverMethod& method)
+    {
+        if (method == SolverMethod::NEWTON_RAPHSON) return getBlackImpliedVolatility(undiscountedPrice, F, K, timeToMaturity, isCall);
+        QUANT_METRIC_INCREMENT(IMPLIED_VOLATILITY_CALLS);
+        QUANT_METRIC_RECORD(IMPLIED_VOLATILITY_ITERATIONS, HOUSEHOLDER_ITERATIONS);
+        double impliedVolatility;
+        try{
+            impliedVolatility = getHouseholderNormalizedVolatility(undiscountedPrice/sqrt(F*K), log(F/K), isCall)/sqrt(timeToMaturity);
+        }catch (const std::exception& e)
+        {
+            impliedVolatility = NAN;
+        }
+        if (std::isnan(impliedVolatility)) QUANT_METRIC_INCREMENT(IMPLIED_VOLATILITY_NAN);
+        return impliedVolatility;
     }
 
     double getBlackImpliedVolatility(double undiscountedPrice, double F, double K, double timeToMaturity, bool isCall)
     {
         //if (undiscountedPrice<0) return NAN;
-
+        QUANT_METRIC_INCREMENT(IMPLIED_VOLATILITY_CALLS);
+        double impliedVolatility;
         try{
-            return getNewtonNormalizedVolatility(undiscountedPrice/sqrt(F*K), log(F/K), true)/sqrt(timeToMaturity);
+            impliedVolatility = getNewtonNormalizedVolatility(undiscountedPrice/sqrt(F*K), log(F/K), isCall)/sqrt(timeToMaturity);
             
         }catch (const std::exception& e)
         {
-            return NAN;
+            impliedVolatility = NAN;
         }
+        if (std::isnan(impliedVolatility)) QUANT_METRIC_INCREMENT(IMPLIED_VOLATILITY_NAN);
+        return impliedVolatility;
+    }
 
+    // Let's be rational mode over one block of m <= 256 normalized quotes: the reduction to an out-of-the-money call and the rational
+    // cubic guess stay scalar (they branch on the interpolation region), the bracket prices b_l, b_c, b_u and the Householder steps run
+    // lane-wise on the region kernels of getPrices and the VectorMath exp/log, the branch of the target is applied by selects.
+    // Lanes where a step would take the log of a subnormal or non-positive price (VectorMath::getLog only covers positive normal
+    // numbers) are solved again by getHouseholderNormalizedVolatility so that they fail or saturate as the scalar path does
+    static void getHouseholderNormalizedVolatilities(const double* beta, const double* x, const bool* isCall, std::size_t m, double* s)
+    {
+        constexpr std::size_t blockSize = 256;
+        double beta_[blockSize], x_[blockSize], b_max[blockSize], sigma_l[blockSize], sigma_c[blockSize], sigma_u[blockSize];
+        double b_l[blockSize], b_c[blockSize], b_u[blockSize], v_c[blockSize], b[blockSize], lower[blockSize], upper[blockSize], fallback[blockSize];
+        bool call[blockSize];
+        // Same reduction as getInitialData: the time value of an in-the-money quote priced as the out-of-the-money call at x = -|x|
+        for (std::size_t j = 0; j < m; ++j)
+        {
+            const bool itm = (isCall[j] ? x[j] : -x[j]) > 0;
+            beta_[j] = itm ? fabs(std::max(beta[j] - BlackTools::getNormalizedIntrisicValue(x[j], isCall[j]), 0.)) : beta[j];
+            x_[j] = -fabs(x[j]);
+            b_max[j] = exp(.5*x_[j]);
+            sigma_c[j] = sqrt(2*fabs(x_[j]));
+            call[j] = true;
+        }
+        UndiscountedBlack::getPrices(x_, sigma_c, call, m, b_c);
+        #pragma omp simd
+        for (std::size_t j = 0; j < m; ++j)
+        {
+            const double v = BlackTools::ONE_OVER_SQRT_TWO_PI*VectorMath::getExp(-0.5*(x_[j]*x_[j]/(sigma_c[j]*sigma_c[j])+0.25*sigma_c[j]*sigma_c[j]));
+            v_c[j] = sigma_c[j] > DBL_MIN ? v : 0.0;
+            const double w = v_c[j] > DBL_MIN ? v_c[j] : 1.0;
+            sigma_u[j] = v_c[j] > DBL_MIN ? sigma_c[j] + (b_max[j] - b_c[j])/w : sigma_c[j];
+            sigma_l[j] = v_c[j] > DBL_MIN ? sigma_c[j] - b_c[j]/w : sigma_c[j];
+        }
+        UndiscountedBlack::getPrices(x_, sigma_u, call, m, b_u);
+        UndiscountedBlack::getPrices(x_, sigma_l, call, m, b_l);
+        for (std::size_t j = 0; j < m; ++j)
+        {
+            lower[j] = (beta_[j] < b_l[j]) ? 1.0 : 0.0;
+            upper[j] = (beta_[j] > std::max(b_u[j], b_max[j]/2)) ? 1.0 : 0.0;
+            fallback[j] = 0.0;
+            if (beta_[j] <= 0) {s[j] = 0.0; continue;}
+            try{
+                s[j] = getInitialGuess(std::make_tuple(beta_[j], x_[j], b_max[j], sigma_l[j], sigma_c[j], sigma_u[j], b_l[j], b_c[j], b_u[j], v_c[j], true));
+            }
+            catch (const std::exception& e){ s[j] = NAN; }
+        }
+        for (int k = 0; k < HOUSEHOLDER_ITERATIONS; ++k)
+        {
+            UndiscountedBlack::getPrices(x_, s, call, m, b);
+            #pragma omp simd
+            for (std::size_t j = 0; j < m; ++j)
+            {
+                // Same step as getHouseholderNormalizedVolatility, the three targets are evaluated and the branch of the quote selected
+                const double sj = s[j], xj = x_[j], bj = b[j], xx = xj*xj, ss = sj*sj;
+                const double v = BlackTools::ONE_OVER_SQRT_TWO_PI*VectorMath::getExp(-0.5*(xx/ss+0.25*ss));
+                const double g = xx/(ss*sj) - .25*sj, h = g*g - 3*xx/(ss*ss) - .25;
+                const double gap = b_max[j] - beta_[j], remaining = b_max[j] - bj;
+                const double lowerRange = beta_[j] < bj ? beta_[j] : bj, upperRange = gap < remaining ? gap : remaining;
+                const double range = lower[j] > 0 ? lowerRange : (upper[j] > 0 ? upperRange : v);
+                const double bl = bj > DBL_MIN ? bj : DBL_MIN, r = remaining > DBL_MIN ? remaining : DBL_MIN;
+                const double l = v/bl, mu = v/r;
+                const double nuLower = (VectorMath::getLog(beta_[j] > DBL_MIN ? beta_[j] : DBL_MIN) - VectorMath::getLog(bl))/l;
+                const double nuUpper = -(VectorMath::getLog(gap > DBL_MIN ? gap : DBL_MIN) - VectorMath::getLog(r))/mu;
+                const double nu = lower[j] > 0 ? nuLower : (upper[j] > 0 ? nuUpper : (beta_[j] - bj)/v);
+                const double gamma = lower[j] > 0 ? g - l : (upper[j] > 0 ? g + mu : g);
+                const double delta = lower[j] > 0 ? h - 3*g*l + 2*l*l : (upper[j] > 0 ? h + 3*g*mu + 2*mu*mu : h);
+                const double step = nu*(1 + .5*gamma*nu)/(1 + nu*(gamma + delta*nu/6));
+                s[j] = beta_[j] > 0 ? sj + step : 0.0;
+                fallback[j] = (beta_[j] > 0 && !(range > DBL_MIN)) ? 1.0 : fallback[j];
+            }
+        }
+        for (std::size_t j = 0; j < m; ++j)
+        {
+            if (fallback[j] == 0) continue;
+            try{
+                s[j] = getHouseholderNormalizedVolatility(beta[j], x[j], isCall[j]);
+            }
+            catch (const std::exception& e){ s[j] = NAN; }
+        }
+    }
+
+    void getBlackImpliedVolatilities(
+        const double* undiscountedPrices, 
+        const double* F, 
+        const double* K, 
+        const double* timeToMaturities, 
+        const bool* isCall, 
+        std::size_t n, 
+        double* impliedVolatilities, 
+        const SolverMethod& method)
+    {
+        // Quotes are processed by blocks so that the normalized inputs stay in L1 between the vectorized passes and the solve
+        constexpr std::size_t blockSize = 256;
+        double beta[blockSize], x[blockSize];
+        for (std::size_t start = 0; start < n; start += blockSize)
+        {
+            const std::size_t m = std::min(blockSize, n - start);
+
+            #pragma omp simd
+            for (std::size_t j = 0; j < m; ++j) beta[j] = undiscountedPrices[start+j]/sqrt(F[start+j]*K[start+j]);
+            // std::log as in the scalar path: deep in-the-money quotes amplify a 1 ulp difference of x beyond 1e-12 in volatility
+            for (std::size_t j = 0; j < m; ++j) x[j] = log(F[start+j]/K[start+j]);
+
+            if (method == SolverMethod::LETS_BE_RATIONAL) getHouseholderNormalizedVolatilities(beta, x, isCall + start, m, impliedVolatilities + start);
+            else for (std::size_t j = 0; j < m; ++j)
+            {
+                try{
+                    impliedVolatilities[start+j] = getInlineNewtonNormalizedVolatility(beta[j], x[j], isCall[start+j]); 
+                }
+                catch (const std::exception& e){ impliedVolatilities[start+j] = NAN; }
+            }
+
+            #pragma omp simd
+            for (std::size_t j = 0; j < m; ++j) impliedVolatilities[start+j] /= sqrt(timeToMaturities[start+j]);
+            QUANT_METRIC_ADD(IMPLIED_VOLATILITY_CALLS, m);
+            QUANT_METRICS_ONLY(for (std::size_t j = 0; j < m; ++j) if (std::isnan(impliedVolatilities[start+j])) QUANT_METRIC_INCREMENT(IMPLIED_VOLATILITY_NAN);)
+        }
+    }
+
+    constexpr int CHEBYSHEV_MAXIMUM_ORDER = 16;
+    // Above ~36 standard deviations the out-of-the-money price is below the smallest normal double
+    constexpr double CHEBYSHEV_MAXIMUM_STANDARDIZED_MONEYNESS = 36.0;
+
+    ChebyshevInterpolant::ChebyshevInterpolant(
+        double minimumNormalizedVolatility,
+        double maximumNormalizedVolatility,
+        double maximumStandardizedMoneyness,
+        int moneynessTiles,
+        int tilesPerOctave,
+        int order):
+    minimumNormalizedVolatility_(minimumNormalizedVolatility), maximumNormalizedVolatility_(std::max(maximumNormalizedVolatility, 2*minimumNormalizedVolatility)),
+    maximumStandardizedMoneyness_(std::min(maximumStandardizedMoneyness, CHEBYSHEV_MAXIMUM_STANDARDIZED_MONEYNESS)),
+    moneynessTiles_(std::max(moneynessTiles, 1)), tilesPerOctave_(std::max(tilesPerOctave, 1)),
+    octaves_(int(std::ceil(std::log2(maximumNormalizedVolatility_/minimumNormalizedVolatility_)))),
+    order_(std::min(std::max(order, 2), CHEBYSHEV_MAXIMUM_ORDER)), buildTime_(0.0), maximumError_(0.0) {classSetter();}
+
+    // sigma*sqrt(T) from 0.5% to 5.12 (10 octaves), up to 30 standard deviations, 16x40 tiles of 10x10 nodes (64k coefficients, ~3e-5 relative error)
+    ChebyshevInterpolant::ChebyshevInterpolant(): ChebyshevInterpolant(0.005, 3.2, 30.0, 16, 4, 10) {};
+
+    int ChebyshevInterpolant::getOrder() const {return order_;}
+    std::size_t ChebyshevInterpolant::getTiles() const {return std::size_t(moneynessTiles_)*octaves_*tilesPerOctave_;}
+    std::size_t ChebyshevInterpolant::getTableSize() const {return coefficients_.size();}
+    double ChebyshevInterpolant::getBuildTime() const {return buildTime_;}
+    double ChebyshevInterpolant::getMaximumError() const {return maximumError_;}
+
+    // s0 of an out-of-the-money call with log(u) = z
+    static inline double getChebyshevCoordinate(double x, double z) {return sqrt(x*x/(-2*z) - 2*BlackTools::PI*log1p(-exp(2*z)));}
+
+    void ChebyshevInterpolant::classSetter()
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        const int p = order_, volatilityTiles = octaves_*tilesPerOctave_;
+        std::vector<double> nodes(p);
+        for (int a = 0; a < p; ++a) nodes[a] = -cos(BlackTools::PI*(a + .5)/p);
+
+        // Exact s/s0 at a point of the table: log(u) is recovered from s0 by safeguarded Newton (s0 is increasing and convex in log(u))
+        auto getExactRatio = [](double standardizedMoneyness, double s0) -> double
+        {
+            const double x = -standardizedMoneyness*s0;
+            auto getResidual = [&](double z) {return getChebyshevCoordinate(x, z) - s0;};
+            double zLow = std::min(-x*x/(s0*s0), log(s0/BlackTools::SQRT_TWO_PI) - 1) - 1, zHigh = 0.0, z = zLow;
+            for (int k = 0; k < 200; ++k)
+            {
+                const double residual = getResidual(z);
+                if (residual < 0) zLow = z; else zHigh = z;
+                const double u2 = exp(2*z), derivative = (x*x/(2*z*z) + 4*BlackTools::PI*u2/(1 - u2))/(2*(residual + s0));
+                double next = z - residual/derivative;
+                if (!(next > zLow and next < zHigh)) next = .5*(zLow + zHigh);
+                if (fabs(next - z) <= 1e-15*fabs(z)) {z = next; break;}
+                z = next;
+            }
+            return getNewtonNormalizedVolatility(exp(z + .5*x), x, true)/s0;
+        };
+        auto getPoint = [&](int i, int j, double tMoneyness, double tVolatility) -> std::pair<double, double>
+        {
+            const double q = 1 + (j % tilesPerOctave_ + .5*(tVolatility + 1))/tilesPerOctave_;
+            const double y = (i + .5*(tMoneyness + 1))/moneynessTiles_;
+            return {maximumStandardizedMoneyness_*y*y, ldexp(minimumNormalizedVolatility_*q, j/tilesPerOctave_)};
+        };
+
+        // Tensor Chebyshev coefficients per tile from the values at the first-kind nodes (discrete cosine transform)
+        coefficients_.assign(getTiles()*p*p, 0.0);
+        std::vector<double> values(p*p);
+        for (int i = 0; i < moneynessTiles_; ++i)
+        {
+            for (int j = 0; j < volatilityTiles; ++j)
+            {
+                for (int a = 0; a < p; ++a)
+                    for (int b = 0; b < p; ++b) {auto [m, s0] = getPoint(i, j, nodes[a], nodes[b]); values[a*p + b] = getExactRatio(m, s0);}
+                double* c = coefficients_.data() + (std::size_t(i)*volatilityTiles + j)*p*p;
+                for (int m = 0; m < p; ++m)
+                    for (int n = 0; n < p; ++n)
+                    {
+                        double sum = 0.0;
+                        for (int a = 0; a < p; ++a)
+                            for (int b = 0; b < p; ++b) sum += values[a*p + b]*cos(BlackTools::PI*m*(a + .5)/p)*cos(BlackTools::PI*n*(b + .5)/p);
+                        // Node order is reversed (nodes ascend), T_m(-t) = (-1)^m T_m(t)
+                        c[m*p + n] = sum*((m + n) % 2 == 0 ? 1 : -1)*(m == 0 ? 1.0 : 2.0)*(n == 0 ? 1.0 : 2.0)/(p*p);
+                    }
+            }
+        }
+        // Off-node check on the lower edges and the center of every tile (upper edges are the lower edges of the next tile)
+        for (int i = 0; i < moneynessTiles_; ++i)
+            for (int j = 0; j < volatilityTiles; ++j)
+                for (double tMoneyness: {-1.0, 0.0})
+                    for (double tVolatility: {-1.0, 0.0})
+                    {
+                        auto [m, s0] = getPoint(i, j, tMoneyness, tVolatility);
+                        maximumError_ = std::max(maximumError_, fabs(getRatio(m, s0)/getExactRatio(m, s0) - 1));
+                    }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        buildTime_ = elapsed.count();
+    }
+
+    double ChebyshevInterpolant::getRatio(double standardizedMoneyness, double s0) const
+    {
+        const int p = order_, volatilityTiles = octaves_*tilesPerOctave_;
+        // Octave of s0 from the exponent bits, then a uniform split inside the octave
+        const double r = s0/minimumNormalizedVolatility_;
+        const int k = std::ilogb(r);
+        const double w = (ldexp(r, -k) - 1)*tilesPerOctave_, y = sqrt(standardizedMoneyness/maximumStandardizedMoneyness_)*moneynessTiles_;
+        const int j = std::min(int(w), tilesPerOctave_ - 1), i = std::min(int(y), moneynessTiles_ - 1);
+        const double tVolatility = 2*(w - j) - 1, tMoneyness = 2*(y - i) - 1;
+
+        double tm[CHEBYSHEV_MAXIMUM_ORDER], tv[CHEBYSHEV_MAXIMUM_ORDER];
+        tm[0] = tv[0] = 1.0; tm[1] = tMoneyness; tv[1] = tVolatility;
+        for (int n = 2; n < p; ++n) {tm[n] = 2*tMoneyness*tm[n-1] - tm[n-2]; tv[n] = 2*tVolatility*tv[n-1] - tv[n-2];}
+        const double* c = coefficients_.data() + (std::size_t(i)*volatilityTiles + k*tilesPerOctave_ + j)*p*p;
+        double ratio = 0.0;
+        for (int m = 0; m < p; ++m)
+        {
+            double row = 0.0;
+            for (int n = 0; n < p; ++n) row += c[m*p + n]*tv[n];
+            ratio += tm[m]*row;
+        }
+        return ratio;
+    }
+
+    double ChebyshevInterpolant::getNormalizedVolatility(double beta, double x, bool isCall, bool polish) const
+    {
+        // Time value of the equivalent out-of-the-money call
+        const double timeValue = beta - BlackTools::getNormalizedIntrisicValue(x, isCall), xOTM = -fabs(x);
+        if (timeValue <= 0) return 0.0;
+        const double logTimeValue = log(timeValue), z = logTimeValue - .5*xOTM;
+        if (z >= 0) return NAN;
+        const double s0 = getChebyshevCoordinate(xOTM, z), standardizedMoneyness = -xOTM/s0;
+        if (!(s0 >= minimumNormalizedVolatility_ and std::ilogb(s0/minimumNormalizedVolatility_) < octaves_ and standardizedMoneyness <= maximumStandardizedMoneyness_))
+            return getHouseholderNormalizedVolatility(beta, x, isCall);
+
+        double s = s0*getRatio(standardizedMoneyness, s0);
+        if (polish)
+        {
+            // Same step as the lower branch of getHouseholderNormalizedVolatility
+            const double b = UndiscountedBlack::getCallPrice(xOTM, s), v = UndiscountedBlack::getVega(xOTM, s), l = v/b;
+            const double g = xOTM*xOTM/(s*s*s) - .25*s, h = g*g - 3*xOTM*xOTM/(s*s*s*s) - .25;
+            const double nu = (logTimeValue - log(b))/l, gamma = g - l, delta = h - 3*g*l + 2*l*l;
+            s += nu*(1 + .5*gamma*nu)/(1 + nu*(gamma + delta*nu/6));
+        }
+        return s;
+    }
+
+    double ChebyshevInterpolant::getBlackImpliedVolatility(double undiscountedPrice, double F, double K, double timeToMaturity, bool isCall, bool polish) const
+    {
+        return getNormalizedVolatility(undiscountedPrice/sqrt(F*K), log(F/K), isCall, polish)/sqrt(timeToMaturity);
     }
 
 }
@@ -295,18 +946,121 @@ namespace Heston
     Parameters::Parameters(double kappa, double theta, double eta, double rho, double v0):  kappa_(kappa), theta_(theta), eta_(eta), rho_(rho), v0_(v0){};
     bool Parameters::isFellerConditionSatisfied() const {return 2.0 * kappa_ * theta_ > eta_ * eta_;}
 
-    std::complex<double> getCharacteristicFunction(std::complex<double> u, double T, const Parameters& hestonParams)
+    std::pair<std::complex<double>, std::complex<double>> getCharacteristicExponents(std::complex<double> u, double T, double kappa, double eta, double rho)
     {
         std::complex<double> i(0.0, 1.0);
-        double e = hestonParams.eta_, k = hestonParams.kappa_, ro = hestonParams.rho_;
+        double e = eta, k = kappa, ro = rho;
         std::complex<double> beta = k - ro*e*i*u;
         std::complex<double> d = sqrt(beta*beta + e*e*(i*u + u*u));
         std::complex<double> g = (beta - d)/(beta + d); 
         std::complex<double> D = (beta - d)*(1.0-exp(-d*T))/(e*e*(1.0-g*exp(-d*T)));
         std::complex<double> C = k*(T*(beta-d) - 2.0*log((1.0-g*exp(-d*T))/(1.0-g)))/(e*e); 
+        return {C, D};
+    }
+
+    std::complex<double> getCharacteristicFunction(std::complex<double> u, double T, const Parameters& hestonParams)
+    {
+        auto [C, D] = getCharacteristicExponents(u, T, hestonParams.kappa_, hestonParams.eta_, hestonParams.rho_);
         return exp(C*hestonParams.theta_+D*hestonParams.v0_); 
     }
 
+    CharacteristicKernel::CharacteristicKernel(std::shared_ptr<const BlackTools::LewisQuadraturePlan> lewisQuadraturePlan, double T, double kappa, double eta, double rho):
+    lewisQuadraturePlan_(std::move(lewisQuadraturePlan))
+    {
+        const std::vector<double>& nodes = lewisQuadraturePlan_->getNodes();
+        thetaExponents_.reserve(nodes.size());
+        v0Exponents_.reserve(nodes.size());
+        for (double u: nodes)
+        {
+            auto [C, D] = getCharacteristicExponents(std::complex<double>(u, -0.5), T, kappa, eta, rho);
+            thetaExponents_.push_back(C);
+            v0Exponents_.push_back(D);
+        }
+    }
+
+    CharacteristicKernel::CharacteristicKernel(const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan, double T, double kappa, double eta, double rho):
+    CharacteristicKernel(std::make_shared<const BlackTools::LewisQuadraturePlan>(lewisQuadraturePlan), T, kappa, eta, rho){}
+
+    std::complex<double> CharacteristicKernel::getCharacteristicFunction(std::size_t node, double theta, double v0) const
+    {
+        return exp(thetaExponents_[node]*theta + v0Exponents_[node]*v0);
+    }
+
+    double CharacteristicKernel::getUndiscountedLewisPrice(double x, double theta, double v0, bool isCall) const
+    {
+        const std::vector<double>& nodes = lewisQuadraturePlan_->getNodes();
+        const std::vector<double>& coefficients = lewisQuadraturePlan_->getCoefficients();
+        double sum = 0.0;
+        for (std::size_t j = 0; j < nodes.size(); ++j) 
+            sum += coefficients[j]*(std::complex<double>(cos(nodes[j]*x), sin(nodes[j]*x))*getCharacteristicFunction(j, theta, v0)).real();
+        double call = exp(x / 2.0) - sum / BlackTools::PI;
+        return isCall ? call : call - (exp(x / 2.0) - exp(-x / 2.0));
+    }
+
+    CharacteristicKernelCache::CharacteristicKernelCache(const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan, std::size_t capacity):
+    lewisQuadraturePlan_(std::make_shared<const BlackTools::LewisQuadraturePlan>(lewisQuadraturePlan)), capacity_(std::max<std::size_t>(capacity, 1)), 
+    hits_(0), misses_(0){}
+
+    CharacteristicKernelCache::CharacteristicKernelCache(const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan): 
+    CharacteristicKernelCache(lewisQuadraturePlan, 64){}
+
+    std::shared_ptr<const CharacteristicKernel> CharacteristicKernelCache::getKernel(double T, const Parameters& hestonParams)
+    {
+        Key key = {T, hestonParams.kappa_, hestonParams.eta_, hestonParams.rho_};
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            ++hits_;
+            kernels_.splice(kernels_.begin(), kernels_, it->second);
+            return it->second->second;
+        }
+        ++misses_;
+        if (kernels_.size() == capacity_)
+        {
+            index_.erase(kernels_.back().first);
+            kernels_.pop_back();
+        }
+        kernels_.emplace_front(key, std::make_shared<const CharacteristicKernel>(lewisQuadraturePlan_, T, hestonParams.kappa_, hestonParams.eta_, hestonParams.rho_));
+        index_.emplace(key, kernels_.begin());
+        return kernels_.front().second;
+    }
+
+    double CharacteristicKernelCache::getUndiscountedLewisPrice(double x, double T, const Parameters& hestonParams, bool isCall)
+    {
+        return getKernel(T, hestonParams)->getUndiscountedLewisPrice(x, hestonParams.theta_, hestonParams.v0_, isCall);
+    }
+
+    std::size_t CharacteristicKernelCache::getHits() const {return hits_;}
+    std::size_t CharacteristicKernelCache::getMisses() const {return misses_;}
+    std::size_t CharacteristicKernelCache::getSize() const {std::lock_guard<std::mutex> lock(mutex_); return kernels_.size();}
+    std::size_t CharacteristicKernelCache::getCapacity() const {return capacity_;}
+    void CharacteristicKernelCache::clear() {std::lock_guard<std::mutex> lock(mutex_); kernels_.clear(); index_.clear(); hits_ = 0; misses_ = 0;}
+
+    std::array<std::complex<double>, 5> getCharacteristicFunctionGradient(std::complex<double> u, double T, const Parameters& hestonParams)
+    {
+        std::complex<double> i(0.0, 1.0);
+        double e = hestonParams.eta_, k = hestonParams.kappa_, ro = hestonParams.rho_;
+        std::complex<double> xi = i*u + u*u;
+        std::complex<double> beta = k - ro*e*i*u;
+        std::complex<double> d = sqrt(beta*beta + e*e*xi);
+        std::complex<double> A = beta - d, B = beta + d, g = A/B, E = exp(-d*T), Q = 1.0 - g*E;
+        std::complex<double> D = A*(1.0-E)/(e*e*Q);
+        std::complex<double> C0 = (T*A - 2.0*log(Q/(1.0-g)))/(e*e);
+        std::complex<double> phi = exp(k*C0*hestonParams.theta_ + D*hestonParams.v0_);
+
+        // Chain rule through beta, d, g and exp(-dT) for p in (kappa, eta, rho), dk and de are the derivatives of kappa and eta
+        auto getDerivative = [&](std::complex<double> dBeta, double dk, double de)
+        {
+            std::complex<double> dd = (beta*dBeta + e*de*xi)/d;
+            std::complex<double> dA = dBeta - dd, dB = dBeta + dd, dg = (dA*B - A*dB)/(B*B), dE = -T*E*dd, dQ = -(dg*E + g*dE);
+            std::complex<double> dD = (dA*(1.0-E) - A*dE)/(e*e*Q) - 2.0*D*de/e - D*dQ/Q;
+            std::complex<double> dC = dk*C0 - 2.0*k*C0*de/e + k*(T*dA - 2.0*dQ/Q - 2.0*dg/(1.0-g))/(e*e);
+            return phi*(dC*hestonParams.theta_ + dD*hestonParams.v0_);
+        };
+        return {getDerivative(1.0, 1.0, 0.0), phi*k*C0, getDerivative(-ro*i*u, 0.0, 1.0), getDerivative(-e*i*u, 0.0, 0.0), phi*D};
+    }
+
     double getUndiscountedLewisPrice(double x, double T, const Parameters& hestonParams, bool isCall, GaussLaguerreQuadrature& gaussLaguerreQuadrature_)
     {
         std::function<std::complex<double>(std::complex<double>)> cf = [T,hestonParams](std::complex<double> u) {
@@ -315,11 +1069,223 @@ namespace Heston
         return BlackTools::getLewisUndiscountedPrice(x, isCall, cf, gaussLaguerreQuadrature_);
     }
 
+    double getUndiscountedLewisPrice(double x, double T, const Parameters& hestonParams, bool isCall, const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan)
+    {
+        QUANT_METRIC_INCREMENT(LEWIS_PRICES);
+        return lewisQuadraturePlan.getUndiscountedPrice(x, isCall, [T, &hestonParams](std::complex<double> u) {
+            return getCharacteristicFunction(u, T, hestonParams);
+        });
+    }
+
     double getImpliedVolatility(double F, double K, double T, const Parameters& hestonParams, GaussLaguerreQuadrature& gaussLaguerreQuadrature_)
     {
-        double undiscountedPrice = getUndiscountedLewisPrice(log(F/K),T,hestonParams, true, gaussLaguerreQuadrature_); 
+        double undiscountedPrice = sqrt(F*K)*getUndiscountedLewisPrice(log(F/K),T,hestonParams, true, gaussLaguerreQuadrature_); 
         return ImpliedVolatilitySolver::getBlackImpliedVolatility(undiscountedPrice,F,K,T,true);
     }
 
-}
+    double getImpliedVolatility(double F, double K, double T, const Parameters& hestonParams, const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan)
+    {
+        double undiscountedPrice = sqrt(F*K)*getUndiscountedLewisPrice(log(F/K),T,hestonParams, true, lewisQuadraturePlan); 
+        return ImpliedVolatilitySolver::getBlackImpliedVolatility(undiscountedPrice,F,K,T,true);
+    }
+
+    Surface getUndiscountedLewisSurface(
+        const std::vector<double>& forwards, 
+        const std::vector<double>& maturities, 
+        const std::vector<double>& strikes, 
+        const Parameters& hestonParams, 
+        const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan)
+    {
+        const std::size_t nMaturities = maturities.size(), nStrikes = strikes.size();
+        Surface surface;
+        surface.undiscountedPrices_.assign(nMaturities, std::vector<double>(nStrikes));
+        surface.impliedVolatilities_.assign(nMaturities, std::vector<double>(nStrikes));
+
+        // Each worker pulls the next maturity and keeps its own buffer of folded characteristic values
+        std::atomic<std::size_t> nextMaturity(0);
+        auto worker = [&](std::size_t)
+        {
+            std::vector<std::complex<double>> foldedValues(lewisQuadraturePlan.getNodes().size());
+            for (std::size_t m = nextMaturity++; m < nMaturities; m = nextMaturity++)
+            {
+                const double T = maturities[m], F = forwards[m];
+                lewisQuadraturePlan.getFoldedCharacteristicValues([T, &hestonParams](std::complex<double> u) {
+                    return getCharacteristicFunction(u, T, hestonParams);
+                }, foldedValues.data());
+                for (std::size_t k = 0; k < nStrikes; ++k)
+                {
+                    const double K = strikes[k];
+                    double price = sqrt(F*K)*lewisQuadraturePlan.getFoldedUndiscountedPrice(log(F/K), true, foldedValues.data());
+                    surface.undiscountedPrices_[m][k] = price;
+                    surface.impliedVolatilities_[m][k] = ImpliedVolatilitySolver::getBlackImpliedVolatility(price, F, K, T, true);
+                }
+            }
+        };
+        ThreadPool& pool = ThreadPool::getInstance();
+        pool.run(std::min(pool.getThreads() + 1, nMaturities), worker);
+        return surface;
+    }
+
+
+    CalibrationQuote::CalibrationQuote(double F, double K, double T, double value, bool isImpliedVolatility): 
+    F_(F), K_(K), T_(T), value_(value), isImpliedVolatility_(isImpliedVolatility){};
+
+    static std::array<double, 5> getParameterArray(const Parameters& params){return {params.kappa_, params.theta_, params.eta_, params.rho_, params.v0_};}
+    static Parameters getParameters(const std::array<double, 5>& params){return Parameters(params[0], params[1], params[2], params[3], params[4]);}
+
+    Calibration::Calibration(const std::vector<CalibrationQuote>& quotes, const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan):
+    lewisQuadraturePlan_(lewisQuadraturePlan), quotes_(quotes), lowerBounds_(1e-4, 1e-4, 1e-4, -0.999, 1e-4), upperBounds_(20.0, 2.0, 5.0, 0.999, 2.0), 
+    useVegaWeighting_(true), maximumIterations_(100), iterations_(0), toleranceThreshold_(1e-10), rootMeanSquaredError_(NAN)
+    {
+        marketPrices_.resize(quotes_.size());
+        vegas_.resize(quotes_.size());
+        for (std::size_t q = 0; q < quotes_.size(); ++q)
+        {
+            const CalibrationQuote& quote = quotes_[q];
+            double x = log(quote.F_/quote.K_), scale = sqrt(quote.F_*quote.K_);
+            double sigma = quote.isImpliedVolatility_ ? quote.value_ : ImpliedVolatilitySolver::getBlackImpliedVolatility(quote.value_, quote.F_, quote.K_, quote.T_, true);
+            marketPrices_[q] = quote.isImpliedVolatility_ ? scale*UndiscountedBlack::getPrice(x, sigma*sqrt(quote.T_), true) : quote.value_;
+            vegas_[q] = scale*sqrt(quote.T_)*UndiscountedBlack::getVega(x, sigma*sqrt(quote.T_));
+            maturityIndexes_[quote.T_].push_back(q);
+        }
+    }
+
+    void Calibration::setBounds(const Parameters& lowerBounds, const Parameters& upperBounds){lowerBounds_ = lowerBounds; upperBounds_ = upperBounds;}
+    void Calibration::setVegaWeighting(bool value){useVegaWeighting_ = value;}
+    void Calibration::setMaximumIterations(int value){maximumIterations_ = value;}
+    void Calibration::setToleranceThreshold(double value){toleranceThreshold_ = value;}
+    int Calibration::getIterations() const {return iterations_;}
+    double Calibration::getRootMeanSquaredError() const {return rootMeanSquaredError_;}
+
+    void Calibration::getResidualsAndJacobian(const std::array<double, 5>& params, std::vector<double>* residuals, std::vector<std::array<double, 5>>* jacobian) const
+    {
+        const Parameters hestonParams = getParameters(params);
+        const std::vector<double>& nodes = lewisQuadraturePlan_.getNodes();
+        const std::vector<double>& coefficients = lewisQuadraturePlan_.getCoefficients();
+        const std::size_t n = nodes.size();
+        std::vector<const std::pair<const double, std::vector<std::size_t>>*> maturities;
+        for (const auto& maturity: maturityIndexes_) maturities.push_back(&maturity);
+
+        // Characteristic function and its gradient are folded once per (node, maturity), each worker pulls the next maturity
+        std::atomic<std::size_t> nextMaturity(0);
+        auto worker = [&](std::size_t)
+        {
+            std::vector<std::complex<double>> foldedValues(residuals ? n : 0);
+            std::vector<std::array<std::complex<double>, 5>> foldedGradients(jacobian ? n : 0);
+            for (std::size_t m = nextMaturity++; m < maturities.size(); m = nextMaturity++)
+            {
+                const double T = maturities[m]->first;
+                for (std::size_t j = 0; j < n; ++j)
+                {
+                    std::complex<double> u(nodes[j], -0.5);
+                    if (residuals) foldedValues[j] = coefficients[j]*getCharacteristicFunction(u, T, hestonParams);
+                    if (!jacobian) continue;
+                    foldedGradients[j] = getCharacteristicFunctionGradient(u, T, hestonParams);
+                    for (std::complex<double>& derivative: foldedGradients[j]) derivative *= coefficients[j];
+                }
+                for (std::size_t q: maturities[m]->second)
+                {
+                    const double x = log(quotes_[q].F_/quotes_[q].K_), scale = sqrt(quotes_[q].F_*quotes_[q].K_);
+                    const double weight = useVegaWeighting_ ? 1.0/std::max(vegas_[q], 1e-8) : 1.0;
+                    if (jacobian)
+                    {
+                        std::array<double, 5> row = {0.0, 0.0, 0.0, 0.0, 0.0};
+                        for (std::size_t j = 0; j < n; ++j)
+                        {
+                            double c = cos(nodes[j]*x), s = sin(nodes[j]*x);
+                            for (int p = 0; p < 5; ++p) row[p] += c*foldedGradients[j][p].real() - s*foldedGradients[j][p].imag();
+                        }
+                        for (int p = 0; p < 5; ++p) (*jacobian)[q][p] = -weight*scale*row[p]/BlackTools::PI;
+                    }
+                    if (residuals) (*residuals)[q] = weight*(scale*lewisQuadraturePlan_.getFoldedUndiscountedPrice(x, true, foldedValues.data()) - marketPrices_[q]);
+                }
+            }
+        };
+        ThreadPool& pool = ThreadPool::getInstance();
+        pool.run(std::min(pool.getThreads() + 1, maturities.size()), worker);
+    }
+
+    Parameters Calibration::calibrate(const Parameters& initialGuess)
+    {
+        const std::size_t m = quotes_.size();
+        const std::array<double, 5> lower = getParameterArray(lowerBounds_), upper = getParameterArray(upperBounds_);
+        std::array<double, 5> params = getParameterArray(initialGuess);
+        for (int p = 0; p < 5; ++p) params[p] = std::min(std::max(params[p], lower[p]), upper[p]);
+
+        std::vector<double> residuals(m), trialResiduals(m);
+        std::vector<std::array<double, 5>> jacobian(m);
+        getResidualsAndJacobian(params, &residuals, &jacobian);
+        double cost = 0.0, lambda = 1e-3;
+        for (double r: residuals) cost += r*r;
+
+        for (iterations_ = 0; iterations_ < maximumIterations_; ++iterations_)
+        {
+            // Normal equations J'J and J'r of the 5 parameters
+            double jtj[5][5] = {}, jtr[5] = {};
+            for (std::size_t q = 0; q < m; ++q)
+            {
+                for (int a = 0; a < 5; ++a)
+                {
+                    jtr[a] += jacobian[q][a]*residuals[q];
+                    for (int b = 0; b <= a; ++b) jtj[a][b] += jacobian[q][a]*jacobian[q][b];
+                }
+            }
+            for (int a = 0; a < 5; ++a) for (int b = a+1; b < 5; ++b) jtj[a][b] = jtj[b][a];
+
+            bool accepted = false;
+            double trialCost = cost, stepNorm = 0.0, paramNorm = 0.0;
+            std::array<double, 5> trial;
+            while (!accepted && lambda < 1e12)
+            {
+                // Solve (J'J + lambda*diag(J'J)) step = -J'r by Gaussian elimination with partial pivoting
+                double system[5][6];
+                for (int a = 0; a < 5; ++a)
+                {
+                    for (int b = 0; b < 5; ++b) system[a][b] = jtj[a][b] + ((a == b) ? lambda*std::max(jtj[a][a], 1e-12) : 0.0);
+                    system[a][5] = -jtr[a];
+                }
+                for (int c = 0; c < 5; ++c)
+                {
+                    int pivot = c;
+                    for (int r = c+1; r < 5; ++r) if (fabs(system[r][c]) > fabs(system[pivot][c])) pivot = r;
+                    for (int b = 0; b < 6; ++b) std::swap(system[c][b], system[pivot][b]);
+                    for (int r = c+1; r < 5; ++r)
+                    {
+                        double factor = system[r][c]/system[c][c];
+                        for (int b = c; b < 6; ++b) system[r][b] -= factor*system[c][b];
+                    }
+                }
+                std::array<double, 5> step;
+                for (int c = 4; c >= 0; --c)
+                {
+                    double sum = system[c][5];
+                    for (int b = c+1; b < 5; ++b) sum -= system[c][b]*step[b];
+                    step[c] = sum/system[c][c];
+                }
+                stepNorm = paramNorm = 0.0;
+                for (int p = 0; p < 5; ++p)
+                {
+                    trial[p] = std::min(std::max(params[p] + step[p], lower[p]), upper[p]);
+                    stepNorm += (trial[p] - params[p])*(trial[p] - params[p]);
+                    paramNorm += params[p]*params[p];
+                }
+                // Rejected trials only cost the residuals, J'J and J'r are reused with the next lambda
+                getResidualsAndJacobian(trial, &trialResiduals, nullptr);
+                trialCost = 0.0;
+                for (double r: trialResiduals) trialCost += r*r;
+                if (trialCost < cost) {accepted = true; lambda = std::max(lambda/10.0, 1e-12);}
+                else lambda *= 10.0;
+            }
+            if (!accepted) break;
+            double improvement = cost - trialCost;
+            params = trial;
+            residuals.swap(trialResiduals);
+            cost = trialCost;
+            if (sqrt(stepNorm) <= toleranceThreshold_*(sqrt(paramNorm) + toleranceThreshold_) || improvement <= toleranceThreshold_*cost) {++iterations_; break;}
+            getResidualsAndJacobian(params, nullptr, &jacobian);
+        }
+        rootMeanSquaredError_ = sqrt(cost/std::max<std::size_t>(m, 1));
+        return getParameters(params);
+    }
 
+}
\ No newline at end of file
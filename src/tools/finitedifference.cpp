@@ -0,0 +1,461 @@
+#include "../../include/cpp-quant/tools/finitedifference.hpp"
+
+namespace FiniteDifference
+{
+    // Width of the log-spot grids in standard deviations of log(S_T) on each side of the spot
+    constexpr double GRID_STANDARD_DEVIATIONS = 6.0;
+    // Penalty factor 1/tol of Forsyth and Vetzal and the convergence threshold of projected SOR
+    constexpr double PENALTY = 1e8;
+    constexpr double PSOR_RELAXATION = 1.2;
+    constexpr double PSOR_TOLERANCE = 1e-12;
+    constexpr std::size_t MAXIMUM_EXERCISE_ITERATIONS = 1000;
+    // Number of Crank-Nicolson steps replaced by two implicit Euler half steps to damp the payoff kink (Rannacher)
+    constexpr std::size_t RANNACHER_STEPS = 2;
+
+    TridiagonalSystem::TridiagonalSystem(const std::vector<double>& lower, const std::vector<double>& diagonal, const std::vector<double>& upper):
+    lower_(lower), diagonal_(diagonal), upper_(upper), factorizedUpper_(diagonal.size()), inversePivots_(diagonal.size())
+    {
+        const std::size_t n = diagonal_.size();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            inversePivots_[i] = 1.0/(diagonal_[i] - (i > 0 ? lower_[i]*factorizedUpper_[i-1] : 0.0));
+            factorizedUpper_[i] = upper_[i]*inversePivots_[i];
+        }
+    }
+
+    std::size_t TridiagonalSystem::getSize() const {return diagonal_.size();}
+
+    void TridiagonalSystem::solve(double* rhs, std::size_t stride, std::size_t width) const
+    {
+        const std::size_t n = diagonal_.size();
+        #pragma omp simd
+        for (std::size_t k = 0; k < width; ++k) rhs[k] *= inversePivots_[0];
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            double* row = rhs + i*stride;
+            const double* previous = row - stride;
+            const double l = lower_[i], inversePivot = inversePivots_[i];
+            #pragma omp simd
+            for (std::size_t k = 0; k < width; ++k) row[k] = (row[k] - l*previous[k])*inversePivot;
+        }
+        for (std::size_t i = n - 1; i-- > 0;)
+        {
+            double* row = rhs + i*stride;
+            const double* next = row + stride;
+            const double u = factorizedUpper_[i];
+            #pragma omp simd
+            for (std::size_t k = 0; k < width; ++k) row[k] -= u*next[k];
+        }
+    }
+
+    void TridiagonalSystem::solve(double* rhs, std::size_t stride, std::size_t width, const double* shift, double* workspace) const
+    {
+        const std::size_t n = diagonal_.size();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            double* row = rhs + i*stride;
+            double* modifiedUpper = workspace + i*width;
+            const double l = lower_[i], d = diagonal_[i], u = upper_[i];
+            const double* s = shift + i*width;
+            if (i == 0)
+            {
+                #pragma omp simd
+                for (std::size_t k = 0; k < width; ++k) {const double pivot = d + s[k]; modifiedUpper[k] = u/pivot; row[k] /= pivot;}
+                continue;
+            }
+            const double* previous = row - stride;
+            const double* previousUpper = modifiedUpper - width;
+            #pragma omp simd
+            for (std::size_t k = 0; k < width; ++k)
+            {
+                const double pivot = d + s[k] - l*previousUpper[k];
+                modifiedUpper[k] = u/pivot;
+                row[k] = (row[k] - l*previous[k])/pivot;
+            }
+        }
+        for (std::size_t i = n - 1; i-- > 0;)
+        {
+            double* row = rhs + i*stride;
+            const double* next = row + stride;
+            const double* modifiedUpper = workspace + i*width;
+            #pragma omp simd
+            for (std::size_t k = 0; k < width; ++k) row[k] -= modifiedUpper[k]*next[k];
+        }
+    }
+
+    // Average of the payoff over the cell [x - h/2, x + h/2], keeps second order convergence whatever the position of the strike
+    static double getCellAveragePayoff(double x, double h, double K, bool isCall)
+    {
+        const double logK = log(K);
+        const double lo = isCall ? std::max(x - .5*h, logK) : x - .5*h, hi = isCall ? x + .5*h : std::min(x + .5*h, logK);
+        if (hi <= lo) return 0.0;
+        return (isCall ? exp(hi) - exp(lo) - K*(hi - lo) : K*(hi - lo) - exp(hi) + exp(lo))/h;
+    }
+
+    static double getBoundaryValue(double S, double K, double tau, double r, double q, bool isCall, bool isAmerican)
+    {
+        const double european = std::max(isCall ? S*exp(-q*tau) - K*exp(-r*tau) : K*exp(-r*tau) - S*exp(-q*tau), 0.0);
+        return isAmerican ? std::max(european, std::max(isCall ? S - K : K - S, 0.0)) : european;
+    }
+
+    // Time steps (counted backward from maturity) after which the holder may exercise
+    static std::vector<char> getExerciseSteps(const Exercise& exercise, const std::vector<double>& exerciseTimes, double T, std::size_t timeSteps)
+    {
+        std::vector<char> steps(timeSteps + 1, exercise == Exercise::AMERICAN);
+        steps[0] = false;
+        if (exercise == Exercise::BERMUDAN)
+        {
+            const double dt = T/timeSteps;
+            for (double t: exerciseTimes)
+            {
+                if (t < 0 or t >= T) continue;
+                steps[std::min<std::size_t>(std::max<std::size_t>(std::size_t(std::lround((T - t)/dt)), 1), timeSteps)] = true;
+            }
+        }
+        return steps;
+    }
+
+    BlackGrid::BlackGrid(double S, double T, double r, double q, double sigma, std::size_t nodes, std::size_t timeSteps):
+    S_(S), T_(T), r_(r), q_(q), sigma_(sigma), nodes_(std::max<std::size_t>(nodes, 5) | 1), timeSteps_(std::max<std::size_t>(timeSteps, RANNACHER_STEPS + 1)),
+    exerciseMethod_(ExerciseMethod::PENALTY), iterations_(0) {classSetter();}
+
+    void BlackGrid::setExerciseMethod(const ExerciseMethod& exerciseMethod) {exerciseMethod_ = exerciseMethod;}
+    std::size_t BlackGrid::getNodes() const {return nodes_;}
+    std::size_t BlackGrid::getTimeSteps() const {return timeSteps_;}
+    const std::vector<double>& BlackGrid::getLogSpots() const {return logSpots_;}
+    std::size_t BlackGrid::getIterations() const {return iterations_;}
+
+    void BlackGrid::classSetter()
+    {
+        h_ = 2*GRID_STANDARD_DEVIATIONS*sigma_*sqrt(T_)/(nodes_ - 1);
+        logSpots_.resize(nodes_);
+        for (std::size_t j = 0; j < nodes_; ++j) logSpots_[j] = log(S_) + (double(j) - double(nodes_/2))*h_;
+
+        // L V = (sigma^2/2) V_xx + (r - q - sigma^2/2) V_x - r V with central differences
+        const double alpha = .5*sigma_*sigma_/(h_*h_), beta = (r_ - q_ - .5*sigma_*sigma_)/(2*h_), dt = T_/timeSteps_;
+        lower_ = alpha - beta; diagonal_ = -2*alpha - r_; upper_ = alpha + beta;
+        std::vector<double> lower(nodes_, -.5*dt*lower_), diagonal(nodes_, 1 - .5*dt*diagonal_), upper(nodes_, -.5*dt*upper_);
+        // Dirichlet rows at both ends
+        lower.front() = upper.front() = lower.back() = upper.back() = 0.0;
+        diagonal.front() = diagonal.back() = 1.0;
+        implicitSystem_ = TridiagonalSystem(lower, diagonal, upper);
+    }
+
+    std::vector<Greeks> BlackGrid::getPrices(const std::vector<double>& strikes, bool isCall, const Exercise& exercise, const std::vector<double>& exerciseTimes)
+    {
+        const std::size_t n = nodes_, nk = strikes.size(), middle = nodes_/2;
+        if (nk == 0) return {};
+        const double dt = T_/timeSteps_;
+        const bool isAmerican = exercise == Exercise::AMERICAN;
+        const std::vector<char> exerciseSteps = getExerciseSteps(exercise, exerciseTimes, T_, timeSteps_);
+        iterations_ = 0;
+
+        std::vector<double> values(n*nk), payoff(n*nk), rhs(n*nk), shift, workspace, penalizedRhs, previousValues(3*nk);
+        const double tolerance = PSOR_TOLERANCE*(1 + *std::max_element(strikes.begin(), strikes.end()));
+        for (std::size_t j = 0; j < n; ++j)
+            for (std::size_t k = 0; k < nk; ++k)
+            {
+                values[j*nk + k] = getCellAveragePayoff(logSpots_[j], h_, strikes[k], isCall);
+                payoff[j*nk + k] = std::max(isCall ? exp(logSpots_[j]) - strikes[k] : strikes[k] - exp(logSpots_[j]), 0.0);
+            }
+        if (isAmerican and exerciseMethod_ == ExerciseMethod::PENALTY) {shift.assign(n*nk, 0.0); workspace.resize(n*nk); penalizedRhs.resize(n*nk);}
+
+        auto setBoundaries = [&](double tau)
+        {
+            for (std::size_t k = 0; k < nk; ++k)
+            {
+                rhs[k] = getBoundaryValue(exp(logSpots_.front()), strikes[k], tau, r_, q_, isCall, isAmerican);
+                rhs[(n - 1)*nk + k] = getBoundaryValue(exp(logSpots_.back()), strikes[k], tau, r_, q_, isCall, isAmerican);
+            }
+        };
+        // (I - dt/2 L) V = rhs, as a linear system or as the complementarity problem V >= payoff of an American step
+        auto solve = [&](bool exercisable)
+        {
+            if (!exercisable) {implicitSystem_.solve(rhs.data(), nk, nk); values.swap(rhs); return;}
+            const double a = -.5*dt*lower_, b = 1 - .5*dt*diagonal_, c = -.5*dt*upper_;
+            if (exerciseMethod_ == ExerciseMethod::PSOR)
+            {
+                // Gauss-Seidel sweeps projected on the payoff, started from the previous values (boundary rows are exact)
+                for (std::size_t k = 0; k < nk; ++k) {values[k] = rhs[k]; values[(n - 1)*nk + k] = rhs[(n - 1)*nk + k];}
+                for (std::size_t sweep = 0; sweep < MAXIMUM_EXERCISE_ITERATIONS; ++sweep)
+                {
+                    double error = 0.0;
+                    for (std::size_t j = 1; j + 1 < n; ++j)
+                    {
+                        double* v = values.data() + j*nk;
+                        const double* p = payoff.data() + j*nk, *r = rhs.data() + j*nk;
+                        #pragma omp simd reduction(max:error)
+                        for (std::size_t k = 0; k < nk; ++k)
+                        {
+                            const double gaussSeidel = (r[k] - a*v[k - nk] - c*v[k + nk])/b;
+                            const double next = std::max(p[k], v[k] + PSOR_RELAXATION*(gaussSeidel - v[k]));
+                            error = std::max(error, fabs(next - v[k]));
+                            v[k] = next;
+                        }
+                    }
+                    ++iterations_;
+                    if (error <= tolerance) break;
+                }
+                return;
+            }
+            // Penalty iterations: (A + P) V = rhs + P payoff with P = PENALTY where V < payoff, until the active set is stable
+            for (std::size_t iteration = 0; iteration < MAXIMUM_EXERCISE_ITERATIONS; ++iteration)
+            {
+                bool changed = false;
+                for (std::size_t j = 1; j + 1 < n; ++j)
+                    for (std::size_t k = 0; k < nk; ++k)
+                    {
+                        const std::size_t node = j*nk + k;
+                        const double penalty = values[node] < payoff[node] ? PENALTY : 0.0;
+                        changed |= penalty != shift[node];
+                        shift[node] = penalty;
+                    }
+                ++iterations_;
+                if (!changed and iteration > 0) break;
+                for (std::size_t node = 0; node < n*nk; ++node) penalizedRhs[node] = rhs[node] + shift[node]*payoff[node];
+                implicitSystem_.solve(penalizedRhs.data(), nk, nk, shift.data(), workspace.data());
+                values.swap(penalizedRhs);
+            }
+        };
+
+        for (std::size_t step = 1; step <= timeSteps_; ++step)
+        {
+            if (step == timeSteps_) std::copy(values.begin() + (middle - 1)*nk, values.begin() + (middle + 2)*nk, previousValues.begin());
+            const double tau = step*dt;
+            if (step <= RANNACHER_STEPS)
+            {
+                // Two implicit Euler half steps share the Crank-Nicolson matrix I - dt/2 L
+                for (double t: {tau - .5*dt, tau})
+                {
+                    rhs = values;
+                    setBoundaries(t);
+                    solve(isAmerican);
+                }
+            }
+            else
+            {
+                for (std::size_t j = 1; j + 1 < n; ++j)
+                {
+                    const double* v = values.data() + j*nk;
+                    double* r = rhs.data() + j*nk;
+                    #pragma omp simd
+                    for (std::size_t k = 0; k < nk; ++k) r[k] = v[k] + .5*dt*(lower_*v[k - nk] + diagonal_*v[k] + upper_*v[k + nk]);
+                }
+                setBoundaries(tau);
+                solve(isAmerican);
+            }
+            if (exercise == Exercise::BERMUDAN and exerciseSteps[step])
+                for (std::size_t node = 0; node < n*nk; ++node) values[node] = std::max(values[node], payoff[node]);
+        }
+
+        std::vector<Greeks> greeks(nk);
+        for (std::size_t k = 0; k < nk; ++k)
+        {
+            const double down = values[(middle - 1)*nk + k], center = values[middle*nk + k], up = values[(middle + 1)*nk + k];
+            const double firstDerivative = (up - down)/(2*h_), secondDerivative = (up - 2*center + down)/(h_*h_);
+            greeks[k] = {center, firstDerivative/S_, (secondDerivative - firstDerivative)/(S_*S_), (previousValues[nk + k] - center)/dt};
+        }
+        return greeks;
+    }
+
+    HestonGrid::HestonGrid(double S, double T, double r, double q, const Heston::Parameters& hestonParams, std::size_t spotNodes, std::size_t varianceNodes, std::size_t timeSteps):
+    S_(S), T_(T), r_(r), q_(q), hestonParams_(hestonParams), spotNodes_(std::max<std::size_t>(spotNodes, 5) | 1),
+    varianceNodes_(std::max<std::size_t>(varianceNodes, 5)), timeSteps_(std::max<std::size_t>(timeSteps, 1)) {classSetter();}
+
+    std::size_t HestonGrid::getSpotNodes() const {return spotNodes_;}
+    std::size_t HestonGrid::getVarianceNodes() const {return varianceNodes_;}
+    std::size_t HestonGrid::getTimeSteps() const {return timeSteps_;}
+    const std::vector<double>& HestonGrid::getVariances() const {return variances_;}
+
+    // Hundsdorfer-Verwer parameter recommended by In 't Hout and Foulon
+    constexpr double HV_THETA = .5 + 0.28867513459481287;
+
+    void HestonGrid::classSetter()
+    {
+        const std::size_t nx = spotNodes_, nv = varianceNodes_;
+        const double kappa = hestonParams_.kappa_, theta = hestonParams_.theta_, eta = hestonParams_.eta_, dt = T_/timeSteps_;
+        const double referenceVariance = std::max(hestonParams_.v0_, theta);
+        h_ = 2*GRID_STANDARD_DEVIATIONS*sqrt(referenceVariance*T_)/(nx - 1);
+        logSpots_.resize(nx);
+        for (std::size_t i = 0; i < nx; ++i) logSpots_[i] = log(S_) + (double(i) - double(nx/2))*h_;
+
+        const double maximumVariance = std::max(1.0, 5*referenceVariance), d = maximumVariance/500;
+        variances_.resize(nv);
+        for (std::size_t j = 0; j < nv; ++j) variances_[j] = d*sinh(asinh(maximumVariance/d)*j/(nv - 1));
+
+        // Non-uniform central stencils, forward difference at v = 0 (the diffusion vanishes) and V_v = V_vv = 0 at the upper bound
+        firstDerivative_.assign(3*nv, 0.0);
+        secondDerivative_.assign(3*nv, 0.0);
+        firstDerivative_[1] = -1/variances_[1]; firstDerivative_[2] = 1/variances_[1];
+        for (std::size_t j = 1; j + 1 < nv; ++j)
+        {
+            const double dm = variances_[j] - variances_[j-1], dp = variances_[j+1] - variances_[j];
+            firstDerivative_[3*j] = -dp/(dm*(dm + dp)); firstDerivative_[3*j + 1] = (dp - dm)/(dm*dp); firstDerivative_[3*j + 2] = dm/(dp*(dm + dp));
+            secondDerivative_[3*j] = 2/(dm*(dm + dp)); secondDerivative_[3*j + 1] = -2/(dm*dp); secondDerivative_[3*j + 2] = 2/(dp*(dm + dp));
+        }
+
+        // Spot direction A1 = (v/2) V_xx + (r - q - v/2) V_x - r/2 V, one matrix per variance row
+        spotSystems_.clear();
+        for (std::size_t j = 0; j < nv; ++j)
+        {
+            const double v = variances_[j], alpha = .5*v/(h_*h_), beta = (r_ - q_ - .5*v)/(2*h_);
+            std::vector<double> lower(nx, -HV_THETA*dt*(alpha - beta)), diagonal(nx, 1 - HV_THETA*dt*(-2*alpha - .5*r_)), upper(nx, -HV_THETA*dt*(alpha + beta));
+            lower.front() = upper.front() = lower.back() = upper.back() = 0.0;
+            diagonal.front() = diagonal.back() = 1.0;
+            spotSystems_.push_back(TridiagonalSystem(lower, diagonal, upper));
+        }
+        // Variance direction A2 = (eta^2 v/2) V_vv + kappa (theta - v) V_v - r/2 V, shared by every spot column
+        std::vector<double> lower(nv), diagonal(nv), upper(nv);
+        for (std::size_t j = 0; j < nv; ++j)
+        {
+            const double diffusion = .5*eta*eta*variances_[j], drift = kappa*(theta - variances_[j]);
+            lower[j] = -HV_THETA*dt*(diffusion*secondDerivative_[3*j] + drift*firstDerivative_[3*j]);
+            diagonal[j] = 1 - HV_THETA*dt*(diffusion*secondDerivative_[3*j + 1] + drift*firstDerivative_[3*j + 1] - .5*r_);
+            upper[j] = -HV_THETA*dt*(diffusion*secondDerivative_[3*j + 2] + drift*firstDerivative_[3*j + 2]);
+        }
+        varianceSystem_ = TridiagonalSystem(lower, diagonal, upper);
+    }
+
+    std::vector<Greeks> HestonGrid::getPrices(const std::vector<double>& strikes, bool isCall, const Exercise& exercise, const std::vector<double>& exerciseTimes) const
+    {
+        const std::size_t nx = spotNodes_, nv = varianceNodes_, nk = strikes.size(), size = nx*nv*nk, middle = nx/2;
+        if (nk == 0) return {};
+        const double kappa = hestonParams_.kappa_, theta = hestonParams_.theta_, eta = hestonParams_.eta_, rho = hestonParams_.rho_;
+        const double dt = T_/timeSteps_;
+        const bool isAmerican = exercise == Exercise::AMERICAN;
+        const std::vector<char> exerciseSteps = getExerciseSteps(exercise, exerciseTimes, T_, timeSteps_);
+        // Values at (spot i, variance j, strike k) are stored at (i*nv + j)*nk + k
+        auto at = [nv, nk](std::size_t i, std::size_t j) {return (i*nv + j)*nk;};
+
+        std::vector<double> values(size), payoff(size), previousValues;
+        for (std::size_t i = 0; i < nx; ++i)
+            for (std::size_t k = 0; k < nk; ++k)
+            {
+                const double average = getCellAveragePayoff(logSpots_[i], h_, strikes[k], isCall);
+                const double intrinsic = std::max(isCall ? exp(logSpots_[i]) - strikes[k] : strikes[k] - exp(logSpots_[i]), 0.0);
+                for (std::size_t j = 0; j < nv; ++j) {values[at(i, j) + k] = average; payoff[at(i, j) + k] = intrinsic;}
+            }
+
+        // Explicit operators on the interior spot nodes (boundary spot nodes are Dirichlet and left at 0)
+        auto applyMixed = [&](const std::vector<double>& w, std::vector<double>& output)
+        {
+            for (std::size_t i = 1; i + 1 < nx; ++i)
+                for (std::size_t j = 1; j + 1 < nv; ++j)
+                {
+                    const double scale = rho*eta*variances_[j]/(2*h_);
+                    double* o = output.data() + at(i, j);
+                    for (std::size_t k = 0; k < nk; ++k) o[k] = 0.0;
+                    for (int b = -1; b <= 1; ++b)
+                    {
+                        const double c = scale*firstDerivative_[3*j + 1 + b];
+                        const double* up = w.data() + at(i + 1, j + b), *down = w.data() + at(i - 1, j + b);
+                        #pragma omp simd
+                        for (std::size_t k = 0; k < nk; ++k) o[k] += c*(up[k] - down[k]);
+                    }
+                }
+        };
+        auto applySpot = [&](const std::vector<double>& w, std::vector<double>& output)
+        {
+            for (std::size_t i = 1; i + 1 < nx; ++i)
+                for (std::size_t j = 0; j < nv; ++j)
+                {
+                    const double v = variances_[j], alpha = .5*v/(h_*h_), beta = (r_ - q_ - .5*v)/(2*h_);
+                    const double* center = w.data() + at(i, j), *up = w.data() + at(i + 1, j), *down = w.data() + at(i - 1, j);
+                    double* o = output.data() + at(i, j);
+                    #pragma omp simd
+                    for (std::size_t k = 0; k < nk; ++k) o[k] = (alpha - beta)*down[k] + (-2*alpha - .5*r_)*center[k] + (alpha + beta)*up[k];
+                }
+        };
+        auto applyVariance = [&](const std::vector<double>& w, std::vector<double>& output)
+        {
+            for (std::size_t i = 1; i + 1 < nx; ++i)
+                for (std::size_t j = 0; j < nv; ++j)
+                {
+                    const double diffusion = .5*eta*eta*variances_[j], drift = kappa*(theta - variances_[j]);
+                    double* o = output.data() + at(i, j);
+                    const double* center = w.data() + at(i, j);
+                    const double c0 = diffusion*secondDerivative_[3*j + 1] + drift*firstDerivative_[3*j + 1] - .5*r_;
+                    #pragma omp simd
+                    for (std::size_t k = 0; k < nk; ++k) o[k] = c0*center[k];
+                    if (j > 0)
+                    {
+                        const double c = diffusion*secondDerivative_[3*j] + drift*firstDerivative_[3*j];
+                        const double* down = w.data() + at(i, j - 1);
+                        #pragma omp simd
+                        for (std::size_t k = 0; k < nk; ++k) o[k] += c*down[k];
+                    }
+                    if (j + 1 < nv)
+                    {
+                        const double c = diffusion*secondDerivative_[3*j + 2] + drift*firstDerivative_[3*j + 2];
+                        const double* up = w.data() + at(i, j + 1);
+                        #pragma omp simd
+                        for (std::size_t k = 0; k < nk; ++k) o[k] += c*up[k];
+                    }
+                }
+        };
+        auto setBoundaries = [&](std::vector<double>& w, double tau)
+        {
+            for (std::size_t k = 0; k < nk; ++k)
+            {
+                const double low = getBoundaryValue(exp(logSpots_.front()), strikes[k], tau, r_, q_, isCall, isAmerican);
+                const double high = getBoundaryValue(exp(logSpots_.back()), strikes[k], tau, r_, q_, isCall, isAmerican);
+                for (std::size_t j = 0; j < nv; ++j) {w[at(0, j) + k] = low; w[at(nx - 1, j) + k] = high;}
+            }
+        };
+        // (I - theta dt A1) and (I - theta dt A2) solves, lines in the spot direction are strided by nv*nk
+        auto solveSpot = [&](std::vector<double>& w) {for (std::size_t j = 0; j < nv; ++j) spotSystems_[j].solve(w.data() + at(0, j), nv*nk, nk);};
+        auto solveVariance = [&](std::vector<double>& w) {for (std::size_t i = 1; i + 1 < nx; ++i) varianceSystem_.solve(w.data() + at(i, 0), nk, nk);};
+
+        std::vector<double> mixed(size, 0.0), spot(size, 0.0), variance(size, 0.0), mixedY(size, 0.0), spotY(size, 0.0), varianceY(size, 0.0);
+        std::vector<double> y0(size), y(size);
+        for (std::size_t step = 1; step <= timeSteps_; ++step)
+        {
+            if (step == timeSteps_) previousValues = values;
+            const double tau = step*dt;
+            // Hundsdorfer-Verwer: explicit predictor, two implicit corrections, then the same with the averaged explicit part
+            applyMixed(values, mixed); applySpot(values, spot); applyVariance(values, variance);
+            for (std::size_t n = 0; n < size; ++n) {y0[n] = values[n] + dt*(mixed[n] + spot[n] + variance[n]); y[n] = y0[n] - HV_THETA*dt*spot[n];}
+            setBoundaries(y, tau); solveSpot(y);
+            for (std::size_t n = 0; n < size; ++n) y[n] -= HV_THETA*dt*variance[n];
+            solveVariance(y);
+
+            applyMixed(y, mixedY); applySpot(y, spotY); applyVariance(y, varianceY);
+            for (std::size_t n = 0; n < size; ++n)
+            {
+                y0[n] += .5*dt*((mixedY[n] + spotY[n] + varianceY[n]) - (mixed[n] + spot[n] + variance[n]));
+                values[n] = y0[n] - HV_THETA*dt*spotY[n];
+            }
+            setBoundaries(values, tau); solveSpot(values);
+            for (std::size_t n = 0; n < size; ++n) values[n] -= HV_THETA*dt*varianceY[n];
+            solveVariance(values);
+
+            if (exerciseSteps[step])
+                for (std::size_t n = 0; n < size; ++n) values[n] = std::max(values[n], payoff[n]);
+        }
+
+        // Quadratic interpolation in variance at v0 of the spot Greeks of the three nearest variance rows
+        const double v0 = hestonParams_.v0_;
+        std::size_t j0 = std::upper_bound(variances_.begin(), variances_.end(), v0) - variances_.begin();
+        j0 = std::min(std::max<std::size_t>(j0, 2), nv - 1) - 2;
+        if (j0 + 3 < nv and v0 - variances_[j0 + 1] > variances_[j0 + 2] - v0) ++j0;
+        double weights[3];
+        for (int a = 0; a < 3; ++a)
+        {
+            weights[a] = 1.0;
+            for (int b = 0; b < 3; ++b) if (a != b) weights[a] *= (v0 - variances_[j0 + b])/(variances_[j0 + a] - variances_[j0 + b]);
+        }
+        std::vector<Greeks> greeks(nk, Greeks{0, 0, 0, 0});
+        for (std::size_t k = 0; k < nk; ++k)
+            for (int a = 0; a < 3; ++a)
+            {
+                const std::size_t j = j0 + a;
+                const double down = values[at(middle - 1, j) + k], center = values[at(middle, j) + k], up = values[at(middle + 1, j) + k];
+                const double firstDerivative = (up - down)/(2*h_), secondDerivative = (up - 2*center + down)/(h_*h_);
+                greeks[k].price_ += weights[a]*center;
+                greeks[k].delta_ += weights[a]*firstDerivative/S_;
+                greeks[k].gamma_ += weights[a]*(secondDerivative - firstDerivative)/(S_*S_);
+                greeks[k].theta_ += weights[a]*(previousValues[at(middle, j) + k] - center)/dt;
+            }
+        return greeks;
+    }
+}
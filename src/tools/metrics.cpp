@@ -0,0 +1,221 @@
+#include <cmath>
+#include <mutex>
+#include <vector>
+#include <limits>
+#include <sstream>
+#include <algorithm>
+#include "../../include/cpp-quant/tools/metrics.hpp"
+
+namespace Metrics
+{
+    namespace
+    {
+        // Written by its thread only: increments are a relaxed load and store, readers see a consistent value per field
+        struct Shard
+        {
+            std::array<std::atomic<std::uint64_t>, COUNTERS> counters_{};
+            std::array<std::atomic<std::uint64_t>, HISTOGRAMS> counts_{};
+            std::array<std::atomic<double>, HISTOGRAMS> sums_{};
+            std::array<std::atomic<double>, HISTOGRAMS> minimums_{};
+            std::array<std::atomic<double>, HISTOGRAMS> maximums_{};
+            std::array<std::array<std::atomic<std::uint64_t>, HISTOGRAM_BUCKETS>, HISTOGRAMS> buckets_{};
+
+            Shard() {clear();}
+
+            void clear()
+            {
+                for (auto& counter: counters_) counter.store(0, std::memory_order_relaxed);
+                for (std::size_t h = 0; h < HISTOGRAMS; ++h)
+                {
+                    counts_[h].store(0, std::memory_order_relaxed);
+                    sums_[h].store(0.0, std::memory_order_relaxed);
+                    minimums_[h].store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+                    maximums_[h].store(-std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+                    for (auto& bucket: buckets_[h]) bucket.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            void mergeInto(Snapshot& snapshot) const
+            {
+                for (std::size_t c = 0; c < COUNTERS; ++c) snapshot.counters_[c] += counters_[c].load(std::memory_order_relaxed);
+                for (std::size_t h = 0; h < HISTOGRAMS; ++h)
+                {
+                    HistogramSnapshot& histogram = snapshot.histograms_[h];
+                    histogram.count_ += counts_[h].load(std::memory_order_relaxed);
+                    histogram.sum_ += sums_[h].load(std::memory_order_relaxed);
+                    histogram.min_ = std::min(histogram.min_, minimums_[h].load(std::memory_order_relaxed));
+                    histogram.max_ = std::max(histogram.max_, maximums_[h].load(std::memory_order_relaxed));
+                    for (std::size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) histogram.buckets_[b] += buckets_[h][b].load(std::memory_order_relaxed);
+                }
+            }
+        };
+
+        template <typename T>
+        inline void add(std::atomic<T>& value, T increment) {value.store(value.load(std::memory_order_relaxed) + increment, std::memory_order_relaxed);}
+
+        Snapshot getEmptySnapshot()
+        {
+            Snapshot snapshot;
+            snapshot.counters_.fill(0);
+            for (HistogramSnapshot& histogram: snapshot.histograms_)
+            {
+                histogram.count_ = 0;
+                histogram.sum_ = 0.0;
+                histogram.min_ = std::numeric_limits<double>::infinity();
+                histogram.max_ = -std::numeric_limits<double>::infinity();
+                histogram.buckets_.fill(0);
+            }
+            return snapshot;
+        }
+
+        // Live shards and the merged values of exited threads
+        struct Registry
+        {
+            std::mutex mutex_;
+            std::vector<Shard*> shards_;
+            Snapshot retired_ = getEmptySnapshot();
+        };
+
+        Registry& getRegistry()
+        {
+            // Never destroyed: thread shards may retire after the end of main
+            static Registry* registry = new Registry();
+            return *registry;
+        }
+
+        struct ShardHandle
+        {
+            Shard shard_;
+            ShardHandle()
+            {
+                Registry& registry = getRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex_);
+                registry.shards_.push_back(&shard_);
+            }
+            ~ShardHandle()
+            {
+                Registry& registry = getRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex_);
+                shard_.mergeInto(registry.retired_);
+                registry.shards_.erase(std::find(registry.shards_.begin(), registry.shards_.end(), &shard_));
+            }
+        };
+
+        Shard& getShard()
+        {
+            thread_local ShardHandle handle;
+            return handle.shard_;
+        }
+
+        const char* COUNTER_NAMES[COUNTERS] = {
+            "black_region1", "black_region2", "black_region3", "black_region4",
+            "implied_volatility_calls", "implied_volatility_nan",
+            "lewis_prices",
+            "nss_ols_fits", "nelson_siegel_calibrations", "svensson_calibrations",
+            "discount_curve_calibrations"};
+
+        const char* HISTOGRAM_NAMES[HISTOGRAMS] = {
+            "implied_volatility_iterations",
+            "nelson_siegel_calibration_us", "svensson_calibration_us",
+            "discount_curve_calibration_us"};
+    }
+
+    const char* getName(Counter counter) {return COUNTER_NAMES[static_cast<std::size_t>(counter)];}
+    const char* getName(Histogram histogram) {return HISTOGRAM_NAMES[static_cast<std::size_t>(histogram)];}
+
+    std::size_t getBucket(double value)
+    {
+        if (!(value >= 1.0)) return 0;
+        int exponent;
+        std::frexp(value, &exponent);
+        return std::min<std::size_t>(exponent, HISTOGRAM_BUCKETS - 1);
+    }
+
+    double HistogramSnapshot::getMean() const {return count_ > 0 ? sum_/count_ : NAN;}
+
+    double HistogramSnapshot::getPercentile(double p) const
+    {
+        if (count_ == 0) return NAN;
+        const double rank = p*count_;
+        std::uint64_t cumulated = 0;
+        for (std::size_t b = 0; b < HISTOGRAM_BUCKETS; ++b)
+        {
+            cumulated += buckets_[b];
+            if (cumulated >= rank and cumulated > 0) return std::min(max_, std::ldexp(1.0, int(b)));
+        }
+        return max_;
+    }
+
+    std::uint64_t Snapshot::getCounter(Counter counter) const {return counters_[static_cast<std::size_t>(counter)];}
+    const HistogramSnapshot& Snapshot::getHistogram(Histogram histogram) const {return histograms_[static_cast<std::size_t>(histogram)];}
+
+    std::string Snapshot::toJson() const
+    {
+        std::ostringstream json;
+        json << "{\"counters\": {";
+        for (std::size_t c = 0; c < COUNTERS; ++c) json << (c ? ", " : "") << "\"" << COUNTER_NAMES[c] << "\": " << counters_[c];
+        json << "}, \"histograms\": {";
+        for (std::size_t h = 0; h < HISTOGRAMS; ++h)
+        {
+            const HistogramSnapshot& histogram = histograms_[h];
+            json << (h ? ", " : "") << "\"" << HISTOGRAM_NAMES[h] << "\": {\"count\": " << histogram.count_ << ", \"sum\": " << histogram.sum_;
+            if (histogram.count_ > 0)
+                json << ", \"min\": " << histogram.min_ << ", \"max\": " << histogram.max_ << ", \"mean\": " << histogram.getMean()
+                     << ", \"p50\": " << histogram.getPercentile(.5) << ", \"p90\": " << histogram.getPercentile(.9) << ", \"p99\": " << histogram.getPercentile(.99);
+            json << ", \"buckets\": [";
+            for (std::size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) json << (b ? ", " : "") << histogram.buckets_[b];
+            json << "]}";
+        }
+        json << "}}";
+        return json.str();
+    }
+
+    std::string Snapshot::toText() const
+    {
+        std::ostringstream text;
+        for (std::size_t c = 0; c < COUNTERS; ++c) text << COUNTER_NAMES[c] << " " << counters_[c] << "\n";
+        for (std::size_t h = 0; h < HISTOGRAMS; ++h)
+        {
+            const HistogramSnapshot& histogram = histograms_[h];
+            text << HISTOGRAM_NAMES[h] << " count=" << histogram.count_;
+            if (histogram.count_ > 0)
+                text << " mean=" << histogram.getMean() << " p50=" << histogram.getPercentile(.5) << " p90=" << histogram.getPercentile(.9)
+                     << " p99=" << histogram.getPercentile(.99) << " max=" << histogram.max_;
+            text << "\n";
+        }
+        return text.str();
+    }
+
+    void increment(Counter counter, std::uint64_t value) {add(getShard().counters_[static_cast<std::size_t>(counter)], value);}
+
+    void record(Histogram histogram, double value)
+    {
+        Shard& shard = getShard();
+        const std::size_t h = static_cast<std::size_t>(histogram);
+        add<std::uint64_t>(shard.counts_[h], 1);
+        add(shard.sums_[h], value);
+        if (value < shard.minimums_[h].load(std::memory_order_relaxed)) shard.minimums_[h].store(value, std::memory_order_relaxed);
+        if (value > shard.maximums_[h].load(std::memory_order_relaxed)) shard.maximums_[h].store(value, std::memory_order_relaxed);
+        add<std::uint64_t>(shard.buckets_[h][getBucket(value)], 1);
+    }
+
+    Snapshot getSnapshot()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex_);
+        Snapshot snapshot = registry.retired_;
+        for (const Shard* shard: registry.shards_) shard->mergeInto(snapshot);
+        return snapshot;
+    }
+
+    void reset()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex_);
+        registry.retired_ = getEmptySnapshot();
+        for (Shard* shard: registry.shards_) shard->clear();
+    }
+
+    ScopedTimer::ScopedTimer(Histogram histogram): histogram_(histogram), start_(std::chrono::steady_clock::now()){}
+    ScopedTimer::~ScopedTimer() {record(histogram_, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_).count());}
+}
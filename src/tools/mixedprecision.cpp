@@ -0,0 +1,136 @@
+#include "../../include/cpp-quant/tools/mixedprecision.hpp"
+
+namespace MixedPrecision
+{
+    // log(F/K) of the Greeks loop: branch-free in float, the library std::log in double
+    static QUANT_VECTOR_INLINE float getLog(float x) {return VectorMath::getLog(x);}
+    static inline double getLog(double x) {return std::log(x);}
+
+    template <typename Scalar>
+    void getPrices(const Scalar* x, const Scalar* normalizedSigma, const bool* isCall, std::size_t n, Scalar* prices)
+    {
+        // The double batch is the library one (branch-free vector kernels, a few ulps from the scalar double overloads)
+        if constexpr (std::is_same_v<Scalar, double>) {UndiscountedBlack::getPrices(x, normalizedSigma, isCall, n, prices); return;}
+        constexpr std::size_t blockSize = 256;
+        std::size_t index[4][blockSize], count[4];
+        Scalar h[4][blockSize], t[4][blockSize], regionPrice[4][blockSize], intrinsic[blockSize];
+        for (std::size_t start = 0; start < n; start += blockSize)
+        {
+            const std::size_t m = std::min(blockSize, n - start);
+            count[0] = count[1] = count[2] = count[3] = 0;
+            for (std::size_t j = 0; j < m; ++j)
+            {
+                const Scalar s = normalizedSigma[start+j], xc = isCall[start+j] ? x[start+j] : -x[start+j];
+                const Scalar bm = std::exp(Scalar(.5)*xc);
+                intrinsic[j] = xc > 0 ? bm - 1/bm : Scalar(0);
+                prices[start+j] = intrinsic[j];
+                if (s <= std::numeric_limits<Scalar>::min()) continue;
+                const Scalar xo = -std::fabs(xc);
+                int region;
+                if (xo < s*Scalar(BlackTools::H_LARGE) and Scalar(.5)*s*s + xo < s*Scalar(BlackTools::T_SMALL + BlackTools::H_LARGE)) region = 0;
+                else if (Scalar(.5)*s < Scalar(BlackTools::T_SMALL)) region = 1;
+                else if (xo + Scalar(.5)*s*s > s*Scalar(.85)) region = 2;
+                else region = 3;
+                const std::size_t k = count[region]++;
+                index[region][k] = j;
+                h[region][k] = xo/s;
+                t[region][k] = Scalar(.5)*s;
+            }
+
+            #pragma omp simd
+            for (std::size_t k = 0; k < count[0]; ++k) regionPrice[0][k] = getCallPriceRegion1(h[0][k], t[0][k]);
+            #pragma omp simd
+            for (std::size_t k = 0; k < count[1]; ++k) regionPrice[1][k] = getCallPriceRegion2(h[1][k], t[1][k]);
+            #pragma omp simd
+            for (std::size_t k = 0; k < count[2]; ++k) regionPrice[2][k] = getCallPriceRegion3(h[2][k], t[2][k]);
+            #pragma omp simd
+            for (std::size_t k = 0; k < count[3]; ++k) regionPrice[3][k] = getCallPriceRegion4(h[3][k], t[3][k]);
+
+            for (int r = 0; r < 4; ++r)
+                for (std::size_t k = 0; k < count[r]; ++k) prices[start+index[r][k]] = intrinsic[index[r][k]] + regionPrice[r][k];
+        }
+    }
+
+    template <typename Scalar>
+    void getGreeks(const Scalar* F, const Scalar* K, const Scalar* T, const Scalar* sigma, const bool* isCall, std::size_t n, GreeksArrays<Scalar>& greeks)
+    {
+        // The double batch is the library one, the arrays are moved over so that every Greek is the library value
+        if constexpr (std::is_same_v<Scalar, double>)
+        {
+            UndiscountedBlack::GreeksArrays library;
+            UndiscountedBlack::getGreeks(F, K, T, sigma, isCall, n, library);
+            greeks.price_ = std::move(library.price_); greeks.delta_ = std::move(library.delta_); greeks.gamma_ = std::move(library.gamma_);
+            greeks.vega_ = std::move(library.vega_); greeks.theta_ = std::move(library.theta_); greeks.vanna_ = std::move(library.vanna_);
+            greeks.volga_ = std::move(library.volga_); greeks.charm_ = std::move(library.charm_); greeks.veta_ = std::move(library.veta_);
+            return;
+        }
+        for (std::vector<Scalar>* output: {&greeks.price_, &greeks.delta_, &greeks.gamma_, &greeks.vega_, &greeks.theta_, &greeks.vanna_, &greeks.volga_, &greeks.charm_, &greeks.veta_})
+            output->resize(n);
+        Scalar *price = greeks.price_.data(), *delta = greeks.delta_.data(), *gamma = greeks.gamma_.data(), *vega = greeks.vega_.data();
+        Scalar *theta = greeks.theta_.data(), *vanna = greeks.vanna_.data(), *volga = greeks.volga_.data(), *charm = greeks.charm_.data(), *veta = greeks.veta_.data();
+        const unsigned char* flags = reinterpret_cast<const unsigned char*>(isCall);
+        constexpr std::size_t blockSize = 256;
+        Scalar x[blockSize], s[blockSize], sqrtT[blockSize], volatility[blockSize];
+        for (std::size_t start = 0; start < n; start += blockSize)
+        {
+            const std::size_t m = std::min(blockSize, n - start);
+            #pragma omp simd
+            for (std::size_t j = 0; j < m; ++j)
+            {
+                // Denominators floored at the smallest normal so that the degenerate quotes give finite (zero) Greeks
+                const Scalar minimum = std::numeric_limits<Scalar>::min();
+                sqrtT[j] = std::sqrt(T[start+j] > minimum ? T[start+j] : minimum);
+                volatility[j] = sigma[start+j] > minimum ? sigma[start+j] : minimum;
+                x[j] = getLog(F[start+j]/K[start+j]);
+                s[j] = sigma[start+j]*std::sqrt(T[start+j]);
+            }
+            getPrices(x, s, isCall + start, m, price + start);
+            #pragma omp simd
+            for (std::size_t j = 0; j < m; ++j)
+            {
+                // The flags are read as bytes (GCC has no vector type for bool) and the vanishing volatility case is applied as a 0/1
+                // factor on the density (selects between a quotient and 0 are left as branches): every Greek but delta is then 0
+                const std::size_t i = start + j;
+                const Scalar w = flags[i] ? Scalar(1) : Scalar(-1), minimum = std::numeric_limits<Scalar>::min();
+                const Scalar total = s[j] > minimum ? s[j] : Scalar(1), live = s[j] > minimum ? Scalar(1) : Scalar(0);
+                const Scalar d1 = x[j]/total + Scalar(.5)*total, d2 = d1 - total;
+                const Scalar pdf = live*getPdf(d1), cdf = getCdf(w*d1), v = F[i]*pdf*sqrtT[j];
+                price[i] *= std::sqrt(F[i]*K[i]);
+                const Scalar intrinsicDelta = F[i] == K[i] ? Scalar(.5)*w : (w*(F[i] - K[i]) > 0 ? w : Scalar(0));
+                delta[i] = s[j] > minimum ? w*cdf : intrinsicDelta;
+                gamma[i] = pdf/(F[i]*total);
+                vega[i] = v;
+                theta[i] = -Scalar(.5)*F[i]*pdf*volatility[j]/sqrtT[j];
+                vanna[i] = -pdf*d2/volatility[j];
+                volga[i] = v*d1*d2/volatility[j];
+                charm[i] = pdf*d2/(2*sqrtT[j]*sqrtT[j]);
+                veta[i] = -Scalar(.5)*F[i]*pdf*(1 + d1*d2)/sqrtT[j];
+            }
+        }
+    }
+
+    template <typename Scalar>
+    Scalar LewisPlan<Scalar>::getPrice(Scalar x, bool isCall) const
+    {
+        // cos and sin stay libm calls (no branch-free kernel), the reduction loop vectorizes only with a vector math library
+        Scalar sum = 0;
+        const std::size_t n = nodes_.size();
+        #pragma omp simd reduction(+:sum)
+        for (std::size_t j = 0; j < n; ++j) sum += std::cos(nodes_[j]*x)*real_[j] - std::sin(nodes_[j]*x)*imaginary_[j];
+        const Scalar call = std::exp(x/2) - sum/Scalar(BlackTools::PI);
+        return isCall ? call : call - (std::exp(x/2) - std::exp(-x/2));
+    }
+
+    template <typename Scalar>
+    void LewisPlan<Scalar>::getPrices(const Scalar* x, std::size_t n, bool isCall, Scalar* prices) const
+    {
+        for (std::size_t i = 0; i < n; ++i) prices[i] = getPrice(x[i], isCall);
+    }
+
+    template void getPrices<float>(const float* x, const float* normalizedSigma, const bool* isCall, std::size_t n, float* prices);
+    template void getPrices<double>(const double* x, const double* normalizedSigma, const bool* isCall, std::size_t n, double* prices);
+    template void getGreeks<float>(const float* F, const float* K, const float* T, const float* sigma, const bool* isCall, std::size_t n, GreeksArrays<float>& greeks);
+    template void getGreeks<double>(const double* F, const double* K, const double* T, const double* sigma, const bool* isCall, std::size_t n, GreeksArrays<double>& greeks);
+    template class LewisPlan<float>;
+    template class LewisPlan<double>;
+}
@@ -0,0 +1,241 @@
+#include "../../include/cpp-quant/tools/montecarlo.hpp"
+
+namespace HestonMonteCarlo
+{
+    // Philox4x32-10 constants (Salmon et al., section 3.3)
+    constexpr std::uint32_t PHILOX_M0 = 0xD2511F53, PHILOX_M1 = 0xCD9E8D57, PHILOX_W0 = 0x9E3779B9, PHILOX_W1 = 0xBB67AE85;
+    constexpr double TWO_POW_MINUS_53 = 1.0/9007199254740992.0;
+    // Switching level between the quadratic and the exponential approximation of the variance (Andersen, section 3.2.3)
+    constexpr double QE_CRITICAL_PSI = 1.5;
+    // Number of blocks per scheduled chunk, moments are accumulated per chunk and reduced in the chunk order
+    constexpr std::size_t BLOCKS_PER_CHUNK = 16;
+
+    // Scalar Philox, simulateBlock runs the same rounds lane by lane
+    static inline void getPhilox(std::uint32_t c0, std::uint32_t c1, std::uint32_t c2, std::uint32_t c3, std::uint32_t k0, std::uint32_t k1, std::uint32_t output[4])
+    {
+        for (int round = 0; round < 10; ++round)
+        {
+            const std::uint64_t p0 = std::uint64_t(PHILOX_M0)*c0, p1 = std::uint64_t(PHILOX_M1)*c2;
+            const std::uint32_t hi0 = std::uint32_t(p0 >> 32), lo0 = std::uint32_t(p0), hi1 = std::uint32_t(p1 >> 32), lo1 = std::uint32_t(p1);
+            c0 = hi1 ^ c1 ^ k0; c1 = lo1; c2 = hi0 ^ c3 ^ k1; c3 = lo0;
+            k0 += PHILOX_W0; k1 += PHILOX_W1;
+        }
+        output[0] = c0; output[1] = c1; output[2] = c2; output[3] = c3;
+    }
+
+    static inline double getUniform(std::uint32_t hi, std::uint32_t lo) {return (double(((std::uint64_t(hi) << 32) | lo) >> 11) + .5)*TWO_POW_MINUS_53;}
+
+    void getPhiloxBlock(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t output[4])
+    {
+        getPhilox(counter[0], counter[1], counter[2], counter[3], key[0], key[1], output);
+    }
+
+    std::pair<double, double> getUniforms(std::uint64_t seed, std::uint64_t path, std::uint32_t step)
+    {
+        std::uint32_t r[4];
+        getPhilox(std::uint32_t(path), std::uint32_t(path >> 32), step, 0, std::uint32_t(seed), std::uint32_t(seed >> 32), r);
+        return {getUniform(r[0], r[1]), getUniform(r[2], r[3])};
+    }
+
+    EuropeanPayoff::EuropeanPayoff(double K, bool isCall): K_(K), isCall_(isCall) {};
+    double EuropeanPayoff::getStrike() const {return K_;}
+    bool EuropeanPayoff::isCall() const {return isCall_;}
+    double EuropeanPayoff::operator()(const double* forwards, std::size_t steps) const
+    {
+        return std::max(isCall_ ? forwards[steps] - K_ : K_ - forwards[steps], 0.0);
+    }
+
+    AsianPayoff::AsianPayoff(double K, bool isCall): K_(K), isCall_(isCall) {};
+    double AsianPayoff::operator()(const double* forwards, std::size_t steps) const
+    {
+        double average = 0.0;
+        for (std::size_t i = 1; i <= steps; ++i) average += forwards[i];
+        average /= steps;
+        return std::max(isCall_ ? average - K_ : K_ - average, 0.0);
+    }
+
+    BarrierPayoff::BarrierPayoff(double K, double barrier, BarrierType type, bool isCall): K_(K), barrier_(barrier), type_(type), isCall_(isCall) {};
+    double BarrierPayoff::operator()(const double* forwards, std::size_t steps) const
+    {
+        const bool isUp = type_ == BarrierType::UP_AND_OUT or type_ == BarrierType::UP_AND_IN;
+        const bool isOut = type_ == BarrierType::UP_AND_OUT or type_ == BarrierType::DOWN_AND_OUT;
+        bool hit = false;
+        for (std::size_t i = 1; i <= steps and !hit; ++i) hit = isUp ? forwards[i] >= barrier_ : forwards[i] <= barrier_;
+        if (hit == isOut) return 0.0;
+        return std::max(isCall_ ? forwards[steps] - K_ : K_ - forwards[steps], 0.0);
+    }
+
+    CliquetPayoff::CliquetPayoff(std::size_t periods, double localFloor, double localCap, double globalFloor, double globalCap):
+    periods_(std::max<std::size_t>(periods, 1)), localFloor_(localFloor), localCap_(localCap), globalFloor_(globalFloor), globalCap_(globalCap) {};
+    double CliquetPayoff::operator()(const double* forwards, std::size_t steps) const
+    {
+        double sum = 0.0;
+        std::size_t previous = 0;
+        for (std::size_t j = 1; j <= periods_; ++j)
+        {
+            const std::size_t reset = (j*steps + periods_/2)/periods_;
+            sum += std::min(std::max(forwards[reset]/forwards[previous] - 1, localFloor_), localCap_);
+            previous = reset;
+        }
+        return std::min(std::max(sum, globalFloor_), globalCap_);
+    }
+
+    Engine::Engine(const Heston::Parameters& hestonParams, double F, double T, std::size_t steps):
+    hestonParams_(hestonParams), F_(F), T_(T), steps_(std::max<std::size_t>(steps, 1)), paths_(100000), seed_(0),
+    threads_(std::max(1u, std::thread::hardware_concurrency())), antithetic_(true) {};
+
+    void Engine::setPaths(std::size_t paths) {paths_ = std::max<std::size_t>(paths, 2);}
+    void Engine::setSeed(std::uint64_t seed) {seed_ = seed;}
+    void Engine::setThreads(std::size_t threads) {threads_ = threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;}
+    void Engine::setAntithetic(bool antithetic) {antithetic_ = antithetic;}
+
+    std::size_t Engine::getSteps() const {return steps_;}
+    std::size_t Engine::getPaths() const {return paths_;}
+    std::size_t Engine::getThreads() const {return threads_;}
+    bool Engine::isAntithetic() const {return antithetic_;}
+
+    void Engine::simulateBlock(std::size_t firstPath, bool antithetic, double* forwards) const
+    {
+        const double kappa = hestonParams_.kappa_, theta = hestonParams_.theta_, eta = hestonParams_.eta_, rho = hestonParams_.rho_;
+        const double dt = T_/steps_, e1 = exp(-kappa*dt);
+        const double c1 = eta*eta*e1*(1 - e1)/kappa, c2 = theta*eta*eta*(1 - e1)*(1 - e1)/(2*kappa);
+        // Log-forward discretization with central weights gamma1 = gamma2 = 1/2 (Andersen, section 4.2)
+        const double K0 = -rho*kappa*theta*dt/eta, K1 = .5*dt*(kappa*rho/eta - .5) - rho/eta, K2 = .5*dt*(kappa*rho/eta - .5) + rho/eta;
+        const double K3 = .5*dt*(1 - rho*rho), K4 = K3, A = K2 + .5*K4;
+        const std::uint32_t k0 = std::uint32_t(seed_), k1 = std::uint32_t(seed_ >> 32);
+        const std::size_t stride = steps_ + 1;
+
+        alignas(64) double x[BLOCK_SIZE], v[BLOCK_SIZE], uv[BLOCK_SIZE], ux[BLOCK_SIZE], zv[BLOCK_SIZE], zx[BLOCK_SIZE];
+        for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane) {x[lane] = 0.0; v[lane] = hestonParams_.v0_; forwards[lane*stride] = F_;}
+        for (std::size_t i = 0; i < steps_; ++i)
+        {
+            // Integer-only pass, one Philox block per lane gives the two uniforms of the step (rounds outside so that lanes vectorize)
+            alignas(64) std::uint32_t w0[BLOCK_SIZE], w1[BLOCK_SIZE], w2[BLOCK_SIZE], w3[BLOCK_SIZE];
+            for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+            {
+                const std::uint64_t path = firstPath + lane;
+                w0[lane] = std::uint32_t(path); w1[lane] = std::uint32_t(path >> 32); w2[lane] = std::uint32_t(i); w3[lane] = 0;
+            }
+            for (std::uint32_t round = 0, r0 = k0, r1 = k1; round < 10; ++round, r0 += PHILOX_W0, r1 += PHILOX_W1)
+            {
+                #pragma omp simd
+                for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+                {
+                    const std::uint64_t p0 = std::uint64_t(PHILOX_M0)*w0[lane], p1 = std::uint64_t(PHILOX_M1)*w2[lane];
+                    w0[lane] = std::uint32_t(p1 >> 32) ^ w1[lane] ^ r0; w1[lane] = std::uint32_t(p1);
+                    w2[lane] = std::uint32_t(p0 >> 32) ^ w3[lane] ^ r1; w3[lane] = std::uint32_t(p0);
+                }
+            }
+            for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+            {
+                const double u1 = getUniform(w0[lane], w1[lane]), u2 = getUniform(w2[lane], w3[lane]);
+                uv[lane] = antithetic ? 1 - u1 : u1; ux[lane] = antithetic ? 1 - u2 : u2;
+            }
+            // The branch-free FAST quantile is inlined in a loop of doubles only (mixing the 32 bits words in keeps it scalar)
+            #pragma omp simd
+            for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+            {
+                zv[lane] = NormalDistribution::getQuantile<NormalDistribution::Accuracy::FAST>(uv[lane]);
+                zx[lane] = NormalDistribution::getQuantile<NormalDistribution::Accuracy::FAST>(ux[lane]);
+            }
+
+            #pragma omp simd
+            for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+            {
+                // Moment-matched next variance, both branches are evaluated and selected to keep the lanes in step (the log and exp
+                // of VectorMath keep the loop vectorized, their arguments here are positive normal and within [-708, 709])
+                const double m = theta + (v[lane] - theta)*e1, psi = (v[lane]*c1 + c2)/(m*m);
+                const double twoOverPsi = 2/psi, b2 = twoOverPsi - 1 + sqrt(twoOverPsi)*sqrt(std::max(twoOverPsi - 1, 0.0)), a = m/(1 + b2);
+                const double quadraticVariance = a*(sqrt(b2) + zv[lane])*(sqrt(b2) + zv[lane]);
+                const double p = std::max((psi - 1)/(psi + 1), 0.0), beta = (1 - p)/m;
+                const double exponentialVariance = uv[lane] <= p ? 0.0 : VectorMath::getLog((1 - p)/(1 - uv[lane]))/beta;
+                const bool quadratic = psi <= QE_CRITICAL_PSI;
+                const double next = quadratic ? quadraticVariance : exponentialVariance;
+
+                // Martingale correction: E[F(t+dt) | F(t), v(t)] = F(t) whenever the moment generating function of v(t+dt) exists at A
+                // (the log of the selected moment generating function is taken once)
+                const double oneMinus2Aa = 1 - 2*A*a, exponentialMoment = p + beta*(1 - p)/(beta - A);
+                const bool hasMoment = (quadratic ? oneMinus2Aa : beta - A) > 0;
+                const double logMoment = VectorMath::getLog(std::max(quadratic ? oneMinus2Aa : exponentialMoment, DBL_MIN));
+                const double correctedK0 = (quadratic ? -A*b2*a/oneMinus2Aa + .5*logMoment : -logMoment) - (K1 + .5*K3)*v[lane];
+                x[lane] += (hasMoment ? correctedK0 : K0) + K1*v[lane] + K2*next + sqrt(K3*v[lane] + K4*next)*zx[lane];
+                v[lane] = next;
+                forwards[lane*stride + i + 1] = F_*VectorMath::getExp(x[lane]);
+            }
+        }
+    }
+
+    std::vector<double> Engine::getPaths(std::size_t firstPath, std::size_t paths, bool antithetic) const
+    {
+        const std::size_t stride = steps_ + 1;
+        std::vector<double> output(paths*stride), block(BLOCK_SIZE*stride);
+        for (std::size_t path = firstPath; path < firstPath + paths;)
+        {
+            // Blocks are aligned on multiples of BLOCK_SIZE, as in the pricer
+            const std::size_t blockStart = path - path % BLOCK_SIZE;
+            simulateBlock(blockStart, antithetic, block.data());
+            for (; path < std::min(blockStart + BLOCK_SIZE, firstPath + paths); ++path)
+                std::copy(block.begin() + (path - blockStart)*stride, block.begin() + (path - blockStart + 1)*stride, output.begin() + (path - firstPath)*stride);
+        }
+        return output;
+    }
+
+    Result Engine::getResult(const Payoff& payoff, const Payoff* control, double controlExpectation) const
+    {
+        const std::size_t stride = steps_ + 1, chunkPaths = BLOCK_SIZE*BLOCKS_PER_CHUNK, chunks = (paths_ + chunkPaths - 1)/chunkPaths;
+        std::vector<Moments> moments(chunks, Moments{0, 0, 0, 0, 0, 0});
+        std::atomic<std::size_t> nextChunk(0);
+
+        auto worker = [&]()
+        {
+            std::vector<double> forwards(BLOCK_SIZE*stride), antitheticForwards(antithetic_ ? BLOCK_SIZE*stride : 0);
+            for (std::size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++)
+            {
+                Moments& sums = moments[chunk];
+                const std::size_t end = std::min((chunk + 1)*chunkPaths, paths_);
+                for (std::size_t blockStart = chunk*chunkPaths; blockStart < end; blockStart += BLOCK_SIZE)
+                {
+                    simulateBlock(blockStart, false, forwards.data());
+                    if (antithetic_) simulateBlock(blockStart, true, antitheticForwards.data());
+                    for (std::size_t lane = 0; lane < std::min(BLOCK_SIZE, end - blockStart); ++lane)
+                    {
+                        const double* path = forwards.data() + lane*stride;
+                        double y = payoff(path, steps_), c = control ? (*control)(path, steps_) : 0.0;
+                        if (antithetic_)
+                        {
+                            const double* antitheticPath = antitheticForwards.data() + lane*stride;
+                            y = .5*(y + payoff(antitheticPath, steps_));
+                            if (control) c = .5*(c + (*control)(antitheticPath, steps_));
+                        }
+                        sums.n_ += 1; sums.y_ += y; sums.c_ += c; sums.yy_ += y*y; sums.cc_ += c*c; sums.yc_ += y*c;
+                    }
+                }
+            }
+        };
+        ThreadPool& pool = ThreadPool::getInstance();
+        pool.run(std::min({threads_, pool.getThreads() + 1, chunks}), [&worker](std::size_t) {worker();});
+
+        Moments total{0, 0, 0, 0, 0, 0};
+        for (const Moments& m: moments) {total.n_ += m.n_; total.y_ += m.y_; total.c_ += m.c_; total.yy_ += m.yy_; total.cc_ += m.cc_; total.yc_ += m.yc_;}
+        const double n = total.n_, meanY = total.y_/n, meanC = total.c_/n;
+        const double varianceY = std::max(total.yy_ - n*meanY*meanY, 0.0)/(n - 1);
+        const double varianceC = std::max(total.cc_ - n*meanC*meanC, 0.0)/(n - 1), covariance = (total.yc_ - n*meanY*meanC)/(n - 1);
+        const double coefficient = control and varianceC > 0 ? covariance/varianceC : 0.0;
+        const double residualVariance = std::max(varianceY - coefficient*covariance, 0.0);
+        return {meanY - coefficient*(meanC - controlExpectation), sqrt(residualVariance/n), std::size_t(n), coefficient};
+    }
+
+    Result Engine::getPrice(const Payoff& payoff) const {return getResult(payoff, nullptr, 0.0);}
+
+    Result Engine::getPrice(const Payoff& payoff, const Payoff& control, double controlExpectation) const
+    {
+        return getResult(payoff, &control, controlExpectation);
+    }
+
+    Result Engine::getPrice(const Payoff& payoff, const EuropeanPayoff& control, const BlackTools::LewisQuadraturePlan& lewisQuadraturePlan) const
+    {
+        const double K = control.getStrike();
+        const double expectation = sqrt(F_*K)*Heston::getUndiscountedLewisPrice(log(F_/K), T_, hestonParams_, control.isCall(), lewisQuadraturePlan);
+        return getResult(payoff, &control, expectation);
+    }
+}
@@ -0,0 +1,58 @@
+#include "../../include/cpp-quant/tools/normal.hpp"
+
+namespace NormalDistribution
+{
+    void getPdf(const double* x, std::size_t n, double* output)
+    {
+        #pragma omp simd
+        for (std::size_t j = 0; j < n; ++j) output[j] = ONE_OVER_SQRT_TWO_PI*VectorMath::getExpMinusHalfSquare(x[j]);
+    }
+
+    void getErfcx(const double* x, std::size_t n, double* output)
+    {
+        #pragma omp simd
+        for (std::size_t j = 0; j < n; ++j) output[j] = VectorMath::getErfcx(x[j]);
+    }
+
+    template <Accuracy accuracy>
+    void getCdf(const double* x, std::size_t n, double* output)
+    {
+        if constexpr (accuracy == Accuracy::FULL)
+        {
+            #pragma omp simd
+            for (std::size_t j = 0; j < n; ++j) output[j] = VectorMath::getCdf(x[j]);
+        }
+        else
+        {
+            #pragma omp simd
+            for (std::size_t j = 0; j < n; ++j) output[j] = getCdf<Accuracy::FAST>(x[j]);
+        }
+    }
+
+    template <Accuracy accuracy>
+    void getQuantile(const double* p, std::size_t n, double* output)
+    {
+        if constexpr (accuracy == Accuracy::FAST)
+        {
+            #pragma omp simd
+            for (std::size_t j = 0; j < n; ++j) output[j] = getQuantile<Accuracy::FAST>(p[j]);
+        }
+        else
+        {
+            #pragma omp simd
+            for (std::size_t j = 0; j < n; ++j)
+            {
+                const double pj = p[j], lower = pj > .5 ? 1.0 - pj : pj, x = getLowerQuantile(lower);
+                // Halley step of the scalar FULL tier, skipped on denormal probabilities where VectorMath::getExp saturates
+                const double u = (VectorMath::getCdf(x) - lower)*SQRT_TWO_PI*VectorMath::getExp(.5*x*x);
+                const double refined = lower < DBL_MIN ? x : x - u/(1.0 + .5*x*u), quantile = pj > .5 ? -refined : refined;
+                output[j] = pj <= 0.0 ? -HUGE_VAL : (pj >= 1.0 ? HUGE_VAL : (pj == pj ? quantile : pj));
+            }
+        }
+    }
+
+    template void getCdf<Accuracy::FULL>(const double* x, std::size_t n, double* output);
+    template void getCdf<Accuracy::FAST>(const double* x, std::size_t n, double* output);
+    template void getQuantile<Accuracy::FULL>(const double* p, std::size_t n, double* output);
+    template void getQuantile<Accuracy::FAST>(const double* p, std::size_t n, double* output);
+}
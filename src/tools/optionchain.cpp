@@ -0,0 +1,83 @@
+#include "../../include/cpp-quant/tools/optionchain.hpp"
+#include "../../include/cpp-quant/tools/threadpool.hpp"
+
+namespace OptionChain
+{
+    RawQuote::RawQuote(double price, double spot, double strike, double maturity, double rate, double dividendYield, bool isCall):
+    price_(price), spot_(spot), strike_(strike), maturity_(maturity), rate_(rate), dividendYield_(dividendYield), isCall_(isCall) {};
+
+    Result getResult(const RawQuote& quote, const ImpliedVolatilitySolver::SolverMethod& method)
+    {
+        Result result = {NAN, NAN, NAN, {NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN}, QuoteStatus::INVALID_INPUT};
+        const double S = quote.spot_, K = quote.strike_, T = quote.maturity_;
+        if (!std::isfinite(quote.price_) or !std::isfinite(quote.rate_) or !std::isfinite(quote.dividendYield_)) return result;
+        if (!(S > 0 and K > 0 and T > 0 and quote.price_ >= 0) or !std::isfinite(S*K*T)) return result;
+
+        // Normalization to the forward measure
+        result.discountFactor_ = exp(-quote.rate_*T);
+        result.forward_ = S*exp((quote.rate_ - quote.dividendYield_)*T);
+        const double F = result.forward_, undiscountedPrice = quote.price_/result.discountFactor_;
+
+        // Arbitrage bounds of the undiscounted premium, the implied volatility only exists strictly inside
+        const double intrinsic = quote.isCall_ ? std::max(F - K, 0.0) : std::max(K - F, 0.0);
+        if (undiscountedPrice <= intrinsic) {result.status_ = QuoteStatus::NO_TIME_VALUE; return result;}
+        if (undiscountedPrice >= (quote.isCall_ ? F : K)) {result.status_ = QuoteStatus::ABOVE_UPPER_BOUND; return result;}
+
+        const double sigma = ImpliedVolatilitySolver::getBlackImpliedVolatility(undiscountedPrice, F, K, T, quote.isCall_, method);
+        if (!std::isfinite(sigma) or sigma <= 0) {result.status_ = QuoteStatus::SOLVER_FAILURE; return result;}
+
+        result.impliedVolatility_ = sigma;
+        result.greeks_ = UndiscountedBlack::getGreeks(F, K, T, sigma, quote.isCall_);
+        result.status_ = QuoteStatus::OK;
+        return result;
+    }
+
+    Pipeline::Pipeline(std::size_t threads): threads_(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads),
+    chunkSize_(256), method_(ImpliedVolatilitySolver::SolverMethod::LETS_BE_RATIONAL), stolenChunks_(0) {};
+
+    Pipeline::Pipeline(): Pipeline(0) {};
+
+    void Pipeline::setChunkSize(std::size_t chunkSize) {chunkSize_ = std::max<std::size_t>(1, chunkSize);}
+    void Pipeline::setSolverMethod(const ImpliedVolatilitySolver::SolverMethod& method) {method_ = method;}
+
+    std::size_t Pipeline::getThreads() const {return threads_;}
+    std::size_t Pipeline::getChunkSize() const {return chunkSize_;}
+    std::size_t Pipeline::getStolenChunks() const {return stolenChunks_.load();}
+
+    std::vector<Result> Pipeline::process(const std::vector<RawQuote>& quotes)
+    {
+        std::vector<Result> results(quotes.size());
+        process(quotes.data(), quotes.size(), results.data());
+        return results;
+    }
+
+    void Pipeline::process(const RawQuote* quotes, std::size_t n, Result* results)
+    {
+        stolenChunks_ = 0;
+        if (n == 0) return;
+        ThreadPool& pool = ThreadPool::getInstance();
+        const std::size_t nThreads = std::min({threads_, pool.getThreads() + 1, (n + chunkSize_ - 1)/chunkSize_});
+        std::unique_ptr<Shard[]> shards(new Shard[nThreads]);
+        for (std::size_t w = 0; w < nThreads; ++w) {shards[w].next_ = w*n/nThreads; shards[w].end_ = (w + 1)*n/nThreads;}
+
+        // Drains a shard chunk by chunk, returns the number of chunks taken
+        auto drain = [&](Shard& shard) -> std::size_t
+        {
+            std::size_t chunks = 0;
+            for (std::size_t begin = shard.next_.fetch_add(chunkSize_); begin < shard.end_; begin = shard.next_.fetch_add(chunkSize_), ++chunks)
+            {
+                const std::size_t end = std::min(begin + chunkSize_, shard.end_);
+                for (std::size_t i = begin; i < end; ++i) results[i] = getResult(quotes[i], method_);
+            }
+            return chunks;
+        };
+        auto worker = [&](std::size_t w)
+        {
+            drain(shards[w]);
+            std::size_t stolen = 0;
+            for (std::size_t v = 1; v < nThreads; ++v) stolen += drain(shards[(w + v) % nThreads]);
+            if (stolen > 0) stolenChunks_ += stolen;
+        };
+        pool.run(nThreads, worker);
+    }
+}
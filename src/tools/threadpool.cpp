@@ -0,0 +1,101 @@
+#include "../../include/cpp-quant/tools/threadpool.hpp"
+
+struct ThreadPool::Job
+{
+    const std::function<void(std::size_t)>* worker_;
+    std::size_t workers_, next_, done_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::exception_ptr exception_;
+};
+
+ThreadPool::ThreadPool(std::size_t threads): stopping_(false)
+{
+    threads_.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++) threads_.emplace_back([this]() {loop();});
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+    for (std::thread& thread : threads_) thread.join();
+}
+
+ThreadPool& ThreadPool::getInstance()
+{
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+std::size_t ThreadPool::getThreads() const {return threads_.size();}
+
+std::size_t ThreadPool::claim(const std::shared_ptr<Job>& job)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (job->next_ == job->workers_) return job->workers_;
+    const std::size_t index = job->next_++;
+    if (job->next_ == job->workers_)
+    {
+        for (auto it = jobs_.begin(); it != jobs_.end(); it++) if (*it == job) {jobs_.erase(it); break;}
+    }
+    return index;
+}
+
+void ThreadPool::execute(Job& job, std::size_t index)
+{
+    try {(*job.worker_)(index);}
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(job.mutex_);
+        if (!job.exception_) job.exception_ = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(job.mutex_);
+    if (++job.done_ == job.workers_) job.condition_.notify_all();
+}
+
+void ThreadPool::loop()
+{
+    while (true)
+    {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() {return stopping_ or !jobs_.empty();});
+            if (jobs_.empty()) return;
+            job = jobs_.front();
+        }
+        const std::size_t index = claim(job);
+        if (index < job->workers_) execute(*job, index);
+    }
+}
+
+void ThreadPool::run(std::size_t workers, const std::function<void(std::size_t)>& worker)
+{
+    if (workers == 0) return;
+    auto job = std::make_shared<Job>();
+    job->worker_ = &worker;
+    job->workers_ = workers;
+    job->next_ = 1;
+    job->done_ = 0;
+    if (workers > 1 and !threads_.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(job);
+        }
+        if (workers - 1 >= threads_.size()) condition_.notify_all();
+        else for (std::size_t w = 1; w < workers; w++) condition_.notify_one();
+    }
+
+    // The caller runs worker 0 then helps with the indexes nobody has claimed yet
+    execute(*job, 0);
+    for (std::size_t index = claim(job); index < workers; index = claim(job)) execute(*job, index);
+
+    std::unique_lock<std::mutex> lock(job->mutex_);
+    job->condition_.wait(lock, [&job]() {return job->done_ == job->workers_;});
+    if (job->exception_) std::rethrow_exception(job->exception_);
+}
@@ -1,4 +1,5 @@
 #include "../../../../include/cpp-quant/valuation/marketdata/termstructures/discountcurve.hpp"
+#include "../../../../include/cpp-quant/tools/metrics.hpp"
 
 DiscountCurve::DiscountCurve(const DateTime& referenceTime, const std::shared_ptr<Svensson>& nssYieldObject): 
 TermStructure(referenceTime), useInterpolation_(false), interpolationMethod_(std::nullopt), 
@@ -19,6 +20,7 @@ svenssonYieldObject_(nullptr), interpolatedLogDiscountPrice_(nullptr), calibrati
 std::optional<DiscountCurve::InterpolationMethod> DiscountCurve::getInterpolationMethod() const{return interpolationMethod_;}
 
 std::shared_ptr<Svensson> DiscountCurve::getSvenssonObject() const {return svenssonYieldObject_;}
+double DiscountCurve::getCalibrationTime() const {return calibrationTime_;}
 
 double DiscountCurve::_getValue(double t) const
 {
@@ -31,6 +33,35 @@ double DiscountCurve::_getValue(double t) const
     else return std::exp(-t*svenssonYieldObject_->getRate(t));
 }
 
+std::vector<double> DiscountCurve::getValues(const std::vector<double>& timesToMaturity) const
+{
+    for (double t: timesToMaturity) checkYearFraction(t);
+    const std::size_t n = timesToMaturity.size();
+    std::vector<double> values(n);
+    if (not useInterpolation_)
+    {
+        svenssonYieldObject_->evaluate(timesToMaturity.data(), n, values.data(), nullptr, nullptr);
+        for (std::size_t k = 0; k < n; ++k) values[k] = std::exp(-timesToMaturity[k]*values[k]);
+        return values;
+    }
+    const double tMax = interpolatedLogDiscountPrice_->getUpperBoundX();
+    std::vector<std::size_t> extrapolated;
+    std::vector<double> times;
+    extrapolated.reserve(n);
+    times.reserve(n);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        const double t = timesToMaturity[k];
+        if (t<=tMax) values[k] = std::exp(interpolatedLogDiscountPrice_->evaluate(t));
+        else {extrapolated.push_back(k); times.push_back(t);}
+    }
+    if (extrapolated.empty()) return values;
+    std::vector<double> rates(times.size());
+    svenssonYieldObject_->evaluate(times.data(), times.size(), rates.data(), nullptr, nullptr);
+    for (std::size_t k = 0; k < extrapolated.size(); ++k) values[extrapolated[k]] = std::exp(-times[k]*rates[k]);
+    return values;
+}
+
 double DiscountCurve::getShortRate() const {return svenssonYieldObject_->getBeta0()+svenssonYieldObject_->getBeta1();}
 
 double DiscountCurve::getSimpleRate(double t) const {checkYearFraction(t); return t==0.0 ? getShortRate() : (1/getValue(t)-1)/t;}
@@ -151,6 +182,8 @@ void DiscountCurve::classSetter(const std::map<double, double>& data, const Inte
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = end - start;
     calibrationTime_ = elapsed.count();
+    QUANT_METRIC_INCREMENT(DISCOUNT_CURVE_CALIBRATIONS);
+    QUANT_METRIC_RECORD(DISCOUNT_CURVE_CALIBRATION_MICROSECONDS, 1e6*calibrationTime_);
 }
 
 void DiscountCurve::classSetter(const std::map<Tenor, double>& data, const Scheduler& scheduler, const InterpolationMethod& interpolationMethod, const InterpolationVariable& dataType) 
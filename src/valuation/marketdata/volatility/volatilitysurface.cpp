@@ -0,0 +1,291 @@
+#include "../../../../include/cpp-quant/valuation/marketdata/volatility/volatilitysurface.hpp"
+
+VolatilitySurface::Quote::Quote(double forward, double strike, double maturity, double volatility): forward_(forward), strike_(strike), maturity_(maturity), volatility_(volatility) {};
+
+double VolatilitySurface::Slice::getTotalVariance(double k) const {const double u = k - m_; return a_ + b_*(rho_*u + std::sqrt(u*u + sigma_*sigma_));}
+
+double VolatilitySurface::Slice::getFirstDerivative(double k) const {const double u = k - m_; return b_*(rho_ + u/std::sqrt(u*u + sigma_*sigma_));}
+
+double VolatilitySurface::Slice::getSecondDerivative(double k) const
+{
+    const double u = k - m_, r = std::sqrt(u*u + sigma_*sigma_);
+    return b_*sigma_*sigma_/(r*r*r);
+}
+
+double VolatilitySurface::Slice::getDensityFactor(double k) const
+{
+    const double w = getTotalVariance(k), dw = getFirstDerivative(k), d2w = getSecondDerivative(k);
+    const double h = 1.0 - .5*k*dw/w;
+    return h*h - .25*dw*dw*(1.0/w + .25) + .5*d2w;
+}
+
+VolatilitySurface::VolatilitySurface(const DateTime& referenceTime, const std::vector<Quote>& quotes, const Parametrization& parametrization):
+MarketData(referenceTime), parametrization_(parametrization), ssviParameters_({0.0, 0.0, 0.0}), rootMeanSquaredError_(0.0) {classSetter(quotes); arbitrageReportSetter();}
+
+VolatilitySurface::Parametrization VolatilitySurface::getParametrization() const {return parametrization_;}
+const std::vector<double>& VolatilitySurface::getMaturities() const {return maturities_;}
+const std::vector<VolatilitySurface::Slice>& VolatilitySurface::getSlices() const {return slices_;}
+VolatilitySurface::SSVIParameters VolatilitySurface::getSSVIParameters() const {return ssviParameters_;}
+double VolatilitySurface::getRootMeanSquaredError() const {return rootMeanSquaredError_;}
+VolatilitySurface::ArbitrageReport VolatilitySurface::getArbitrageReport() const {return arbitrageReport_;}
+
+void VolatilitySurface::classSetter(const std::vector<Quote>& quotes)
+{
+    using namespace QuantErrorRegistry::Valuation::MarketData::VolatilitySurface;
+    if (quotes.empty()) throw EmptyVolatilityQuotesError();
+
+    // Quotes grouped by expiry, the forward of an expiry is the geometric average of its quotes
+    std::map<double, SliceData> data;
+    std::map<double, std::pair<double, int>> logForwards;
+    for (const Quote& q: quotes)
+    {
+        if (q.forward_<=0 or q.strike_<=0 or q.maturity_<=0 or q.volatility_<=0) throw InvalidVolatilityQuoteError();
+        data[q.maturity_].push_back({std::log(q.strike_/q.forward_), q.volatility_*q.volatility_*q.maturity_});
+        logForwards[q.maturity_].first += std::log(q.forward_);
+        logForwards[q.maturity_].second += 1;
+    }
+
+    minimumLogMoneyness_ = HUGE_VAL; maximumLogMoneyness_ = -HUGE_VAL;
+    for (auto& d: data)
+    {
+        std::sort(d.second.begin(), d.second.end());
+        minimumLogMoneyness_ = std::min(minimumLogMoneyness_, d.second.front().first);
+        maximumLogMoneyness_ = std::max(maximumLogMoneyness_, d.second.back().first);
+        maturities_.push_back(d.first);
+        logForwards_.push_back(logForwards[d.first].first/logForwards[d.first].second);
+    }
+
+    if (parametrization_ == Parametrization::SVI)
+    {
+        for (const auto& d: data)
+        {
+            if (d.second.size() < MINIMUM_SVI_QUOTES) throw InsufficientSliceQuotesError();
+            slices_.push_back(getSVISlice(d.second));
+        }
+    }
+    else
+    {
+        // The ATM total variance is floored to be non-decreasing so the global fit is calendar arbitrage free by construction
+        std::vector<double> thetas;
+        for (const auto& d: data) thetas.push_back(std::max(getATMTotalVariance(d.second), thetas.empty() ? 0.0 : thetas.back()));
+
+        // Unconstrained variables mapped into the sufficient no-arbitrage domain: |rho| < 1, gamma in (0, 1/2) and eta*(1+|rho|) <= 2
+        auto getParameters = [](const std::vector<double>& x) -> SSVIParameters {
+            const double rho = std::tanh(x[0]);
+            return {rho, std::min(std::exp(x[1]), 2.0/(1.0 + std::abs(rho))), .25*(1.0 + std::tanh(x[2]))};
+        };
+        std::function<double(std::vector<double>)> targetFunction = [&](const std::vector<double>& x) -> double {
+            const SSVIParameters parameters = getParameters(x);
+            double squaredError = 0.0;
+            std::size_t i = 0;
+            for (const auto& d: data)
+            {
+                const Slice slice = getSSVISlice(thetas[i++], parameters);
+                for (const auto& p: d.second) {const double e = slice.getTotalVariance(p.first) - p.second; squaredError += e*e;}
+            }
+            return squaredError;
+        };
+        std::vector<double> x0 = {-.3, 0.0, 0.0};
+        NelderMead nm = NelderMead(x0, targetFunction);
+        nm.setInitSimplexMethod(NelderMead::InitSimplexMethod::SYMMETRIC);
+        nm.setPerturbationParam(.5);
+        nm.optimize();
+        ssviParameters_ = getParameters(nm.getError() ? x0 : nm.getResult());
+        for (double theta: thetas) slices_.push_back(getSSVISlice(theta, ssviParameters_));
+    }
+
+    // Fit error in implied volatility
+    std::size_t i = 0, n = 0;
+    for (const auto& d: data)
+    {
+        for (const auto& p: d.second)
+        {
+            const double e = std::sqrt(slices_[i].getTotalVariance(p.first)/d.first) - std::sqrt(p.second/d.first);
+            rootMeanSquaredError_ += e*e; ++n;
+        }
+        ++i;
+    }
+    rootMeanSquaredError_ = std::sqrt(rootMeanSquaredError_/n);
+}
+
+VolatilitySurface::Slice VolatilitySurface::getSVISlice(const SliceData& data)
+{
+    // Outer search on (m, log(sigma)), the three remaining parameters are solved in closed form
+    std::size_t atm = 0;
+    for (std::size_t j = 1; j < data.size(); ++j) if (data[j].second < data[atm].second) atm = j;
+    std::function<double(std::vector<double>)> targetFunction = [&](const std::vector<double>& x) -> double {
+        double squaredError;
+        getSVISlice(data, x[0], std::exp(x[1]), squaredError);
+        return squaredError;
+    };
+    std::vector<double> x0 = {data[atm].first, std::log(.1)};
+    NelderMead nm = NelderMead(x0, targetFunction);
+    nm.setInitSimplexMethod(NelderMead::InitSimplexMethod::SYMMETRIC);
+    nm.setPerturbationParam(.1);
+    nm.optimize();
+    const std::vector<double> x = nm.getError() ? x0 : nm.getResult();
+    double squaredError;
+    return getSVISlice(data, x[0], std::exp(x[1]), squaredError);
+}
+
+VolatilitySurface::Slice VolatilitySurface::getSVISlice(const SliceData& data, double m, double sigma, double& squaredError)
+{
+    // With y = (k-m)/sigma the slice is linear in (a, d, c): w = a + d*y + c*sqrt(y^2+1), with b = c/sigma and rho = d/c
+    const std::size_t n = data.size();
+    double sy = 0, sz = 0, syy = 0, syz = 0, szz = 0, sw = 0, syw = 0, szw = 0, wMax = 0;
+    for (const auto& p: data)
+    {
+        const double y = (p.first - m)/sigma, z = std::sqrt(y*y + 1.0), w = p.second;
+        sy += y; sz += z; syy += y*y; syz += y*z; szz += z*z; sw += w; syw += y*w; szw += z*w;
+        wMax = std::max(wMax, w);
+    }
+    // Least squares in x = (a, d, c): minimize x'Ax - 2r'x on Zeliade's admissible domain, the polytope Gx <= h given by |d| <= c,
+    // |d| <= 4*sigma - c (Lee's wing bound) and 0 <= a <= max(w), on which the total variance is non-negative by construction.
+    // The optimum is the unconstrained one when admissible, otherwise it lies on a face, an edge or a vertex: the optimum on every
+    // active set of at most 3 constraints is solved from its KKT system [A G_S'; G_S 0](x, mu) = (r, h_S), the best admissible one wins.
+    const double A[3][3] = {{double(n), sy, sz}, {sy, syy, syz}, {sz, syz, szz}}, r[3] = {sw, syw, szw};
+    const double G[6][3] = {{0, 1, -1}, {0, -1, -1}, {0, 1, 1}, {0, -1, 1}, {-1, 0, 0}, {1, 0, 0}};
+    const double h[6] = {0, 0, 4*sigma, 4*sigma, 0, wMax};
+    const double tolerance = 1e-12*(4*sigma + wMax);
+    double x[3] = {0.0, 0.0, 0.0}, cost = HUGE_VAL;
+    for (int activeSet = 0; activeSet < 64; ++activeSet)
+    {
+        int active[6], k = 0;
+        for (int i = 0; i < 6; ++i) if ((activeSet >> i) & 1) active[k++] = i;
+        if (k > 3) continue;
+        const int size = 3 + k;
+        double system[6][7] = {}, scale = 0.0;
+        for (int u = 0; u < 3; ++u) {for (int v = 0; v < 3; ++v) system[u][v] = A[u][v]; system[u][size] = r[u];}
+        for (int l = 0; l < k; ++l)
+        {
+            for (int v = 0; v < 3; ++v) system[3+l][v] = system[v][3+l] = G[active[l]][v];
+            system[3+l][size] = h[active[l]];
+        }
+        for (int u = 0; u < size; ++u) for (int v = 0; v < size; ++v) scale = std::max(scale, std::abs(system[u][v]));
+        // Gaussian elimination with partial pivoting, rank deficient active sets are skipped
+        bool isSingular = false;
+        for (int c = 0; c < size and !isSingular; ++c)
+        {
+            int pivot = c;
+            for (int u = c+1; u < size; ++u) if (std::abs(system[u][c]) > std::abs(system[pivot][c])) pivot = u;
+            if (std::abs(system[pivot][c]) <= 1e-13*scale) {isSingular = true; break;}
+            for (int v = 0; v <= size; ++v) std::swap(system[c][v], system[pivot][v]);
+            for (int u = c+1; u < size; ++u)
+            {
+                const double factor = system[u][c]/system[c][c];
+                for (int v = c; v <= size; ++v) system[u][v] -= factor*system[c][v];
+            }
+        }
+        if (isSingular) continue;
+        double solution[6];
+        for (int c = size-1; c >= 0; --c)
+        {
+            double sum = system[c][size];
+            for (int v = c+1; v < size; ++v) sum -= system[c][v]*solution[v];
+            solution[c] = sum/system[c][c];
+        }
+        bool isAdmissible = true;
+        for (int i = 0; i < 6; ++i) isAdmissible = isAdmissible and G[i][0]*solution[0] + G[i][1]*solution[1] + G[i][2]*solution[2] <= h[i] + tolerance;
+        if (!isAdmissible) continue;
+        double candidateCost = 0.0;
+        for (int u = 0; u < 3; ++u) candidateCost += solution[u]*(.5*(A[u][0]*solution[0] + A[u][1]*solution[1] + A[u][2]*solution[2]) - r[u]);
+        if (candidateCost < cost) {cost = candidateCost; std::copy(solution, solution + 3, x);}
+    }
+    // Rounding of the active constraints
+    const double c = std::min(std::max(x[2], 0.0), 4*sigma), dMax = std::min(c, 4*sigma - c);
+    const double a = std::min(std::max(x[0], 0.0), wMax), d = std::min(std::max(x[1], -dMax), dMax);
+    squaredError = 0.0;
+    for (const auto& p: data)
+    {
+        const double y = (p.first - m)/sigma, e = a + d*y + c*std::sqrt(y*y + 1.0) - p.second;
+        squaredError += e*e;
+    }
+    return {a, c/sigma, (c > 0) ? d/c : 0.0, m, sigma};
+}
+
+VolatilitySurface::Slice VolatilitySurface::getSSVISlice(double theta, const SSVIParameters& parameters)
+{
+    // Power-law phi(theta) = eta/(theta^gamma*(1+theta)^(1-gamma)), mapped to raw SVI (Gatheral and Jacquier lemma 3.3)
+    const double phi = parameters.eta_/(std::pow(theta, parameters.gamma_)*std::pow(1.0 + theta, 1.0 - parameters.gamma_));
+    const double rho = parameters.rho_;
+    return {.5*theta*(1.0 - rho*rho), .5*theta*phi, rho, -rho/phi, std::sqrt(1.0 - rho*rho)/phi};
+}
+
+double VolatilitySurface::getATMTotalVariance(const SliceData& data)
+{
+    if (data.front().first >= 0) return data.front().second;
+    if (data.back().first <= 0) return data.back().second;
+    auto it = std::lower_bound(data.begin(), data.end(), std::make_pair(0.0, -HUGE_VAL));
+    auto prev = std::prev(it);
+    return prev->second + (it->second - prev->second)*(-prev->first)/(it->first - prev->first);
+}
+
+void VolatilitySurface::arbitrageReportSetter()
+{
+    const double width = maximumLogMoneyness_ - minimumLogMoneyness_;
+    const double kMin = minimumLogMoneyness_ - .5*width, dk = 2*width/(ARBITRAGE_GRID_POINTS - 1);
+    arbitrageReport_ = {true, 0, 0, HUGE_VAL, HUGE_VAL};
+    for (std::size_t i = 0; i < slices_.size(); ++i)
+    {
+        for (int j = 0; j < ARBITRAGE_GRID_POINTS; ++j)
+        {
+            const double k = kMin + j*dk;
+            const double g = slices_[i].getDensityFactor(k);
+            arbitrageReport_.worstDensityFactor_ = std::min(arbitrageReport_.worstDensityFactor_, g);
+            if (g < -1e-12) arbitrageReport_.butterflyViolations_ += 1;
+            if (i == 0) continue;
+            const double spread = slices_[i].getTotalVariance(k) - slices_[i-1].getTotalVariance(k);
+            arbitrageReport_.worstCalendarSpread_ = std::min(arbitrageReport_.worstCalendarSpread_, spread);
+            if (spread < -1e-12) arbitrageReport_.calendarViolations_ += 1;
+        }
+    }
+    arbitrageReport_.isArbitrageFree_ = arbitrageReport_.butterflyViolations_ == 0 and arbitrageReport_.calendarViolations_ == 0;
+}
+
+std::size_t VolatilitySurface::getUpperSliceIndex(double T) const {return std::upper_bound(maturities_.begin(), maturities_.end(), T) - maturities_.begin();}
+
+double VolatilitySurface::getLogForward(double T, std::size_t i) const
+{
+    if (i == 0) return logForwards_.front();
+    if (i == maturities_.size()) return logForwards_.back();
+    const double alpha = (T - maturities_[i-1])/(maturities_[i] - maturities_[i-1]);
+    return logForwards_[i-1] + alpha*(logForwards_[i] - logForwards_[i-1]);
+}
+
+double VolatilitySurface::getVariance(double k, double T, std::size_t i) const
+{
+    // Flat implied volatility outside the quoted expiries, linear total variance in between
+    if (i == 0) return slices_.front().getTotalVariance(k)/maturities_.front();
+    if (i == maturities_.size()) return slices_.back().getTotalVariance(k)/maturities_.back();
+    const double alpha = (T - maturities_[i-1])/(maturities_[i] - maturities_[i-1]);
+    return ((1.0 - alpha)*slices_[i-1].getTotalVariance(k) + alpha*slices_[i].getTotalVariance(k))/T;
+}
+
+double VolatilitySurface::getForward(double T) const {checkYearFraction(T); return std::exp(getLogForward(T, getUpperSliceIndex(T)));}
+
+double VolatilitySurface::getTotalVariance(double k, double T) const {checkYearFraction(T); return getVariance(k, T, getUpperSliceIndex(T))*T;}
+
+double VolatilitySurface::getVolatility(double K, double T) const
+{
+    checkYearFraction(T);
+    const std::size_t i = getUpperSliceIndex(T);
+    return std::sqrt(getVariance(std::log(K) - getLogForward(T, i), T, i));
+}
+
+std::vector<double> VolatilitySurface::getVolatilities(const std::vector<double>& strikes, const std::vector<double>& maturities) const
+{
+    // Bracketing and forward are resolved once per maturity, log-strikes once per grid
+    const std::size_t nK = strikes.size();
+    std::vector<double> logStrikes(nK), output(nK*maturities.size());
+    for (std::size_t j = 0; j < nK; ++j) logStrikes[j] = std::log(strikes[j]);
+    for (std::size_t l = 0; l < maturities.size(); ++l)
+    {
+        const double T = maturities[l];
+        checkYearFraction(T);
+        const std::size_t i = getUpperSliceIndex(T);
+        const double logForward = getLogForward(T, i);
+        double* row = output.data() + l*nK;
+        for (std::size_t j = 0; j < nK; ++j) row[j] = std::sqrt(getVariance(logStrikes[j] - logForward, T, i));
+    }
+    return output;
+}
@@ -44,6 +44,84 @@ void testUndiscountedBlack()
 
 }
 
+void testUndiscountedBlackBatchPrices()
+{
+    std::vector<double> x, sigma;
+    std::vector<char> isCall;
+    for (double s = 0.0; s < 7; s+= .05)
+    {
+        for (double k = -20; k<=20; k+=0.25)
+        {
+            for (bool c: {true, false}) {x.push_back(k); sigma.push_back(s); isCall.push_back(c);}
+        }
+    }
+    std::unique_ptr<bool[]> isCallBuffer(new bool[isCall.size()]);
+    for (std::size_t j = 0; j < isCall.size(); ++j) isCallBuffer[j] = isCall[j];
+    std::vector<double> prices(x.size());
+    UndiscountedBlack::getPrices(x.data(), sigma.data(), isCallBuffer.get(), x.size(), prices.data());
+    for (std::size_t j = 0; j < x.size(); ++j)
+    {
+        double expected = UndiscountedBlack::getPrice(x[j], sigma[j], isCall[j]);
+        assert(isClose(prices[j], expected, 1e-14*std::max(1.0, expected)));
+    }
+    std::cout << "Undiscounted Black batch prices Passed! (Region-partitioned kernels)"<<std::endl;
+}
+
+void testUndiscountedBlackGreeks()
+{
+    // Bump-and-reprice with central differences on the undiscounted price
+    auto price = [](double F, double K, double T, double sigma, bool c) {return sqrt(F*K)*UndiscountedBlack::getPrice(log(F/K), sigma*sqrt(T), c);};
+    auto agrees = [](double value, double bumped, double tol) {return isClose(value, bumped, tol*std::max(1.0, std::abs(bumped)));};
+    std::vector<double> forwards, strikes, maturities, sigmas;
+    std::vector<char> isCall;
+    for (double K: {60.0, 90.0, 100.0, 115.0, 160.0})
+    {
+        for (double T: {0.1, 1.0, 5.0})
+        {
+            for (double sigma: {0.1, 0.3, 0.8})
+            {
+                for (bool c: {true, false})
+                {
+                    double F = 100.0, hF = 1e-4*F, hT = 1e-5, hS = 1e-4;
+                    UndiscountedBlack::Greeks g = UndiscountedBlack::getGreeks(F, K, T, sigma, c);
+                    assert(isClose(g.price_, price(F,K,T,sigma,c), 1e-12));
+                    assert(agrees(g.delta_, (price(F+hF,K,T,sigma,c) - price(F-hF,K,T,sigma,c))/(2*hF), 1e-5));
+                    assert(agrees(g.gamma_, (price(F+hF,K,T,sigma,c) - 2*price(F,K,T,sigma,c) + price(F-hF,K,T,sigma,c))/(hF*hF), 1e-5));
+                    assert(agrees(g.vega_, (price(F,K,T,sigma+hS,c) - price(F,K,T,sigma-hS,c))/(2*hS), 1e-5));
+                    assert(agrees(g.theta_, -(price(F,K,T+hT,sigma,c) - price(F,K,T-hT,sigma,c))/(2*hT), 1e-5));
+                    assert(agrees(g.volga_, (price(F,K,T,sigma+hS,c) - 2*price(F,K,T,sigma,c) + price(F,K,T,sigma-hS,c))/(hS*hS), 1e-4));
+                    assert(agrees(g.vanna_, (UndiscountedBlack::getGreeks(F+hF,K,T,sigma,c).vega_ - UndiscountedBlack::getGreeks(F-hF,K,T,sigma,c).vega_)/(2*hF), 1e-5));
+                    // theta, charm and veta share the calendar time convention -d/dT
+                    assert(agrees(g.charm_, -(UndiscountedBlack::getGreeks(F,K,T+hT,sigma,c).delta_ - UndiscountedBlack::getGreeks(F,K,T-hT,sigma,c).delta_)/(2*hT), 1e-5));
+                    assert(agrees(g.veta_, -(UndiscountedBlack::getGreeks(F,K,T+hT,sigma,c).vega_ - UndiscountedBlack::getGreeks(F,K,T-hT,sigma,c).vega_)/(2*hT), 1e-5));
+                    forwards.push_back(F); strikes.push_back(K); maturities.push_back(T); sigmas.push_back(sigma); isCall.push_back(c);
+                }
+            }
+        }
+    }
+    std::unique_ptr<bool[]> isCallBuffer(new bool[isCall.size()]);
+    for (std::size_t j = 0; j < isCall.size(); ++j) isCallBuffer[j] = isCall[j];
+    UndiscountedBlack::GreeksArrays greeks;
+    UndiscountedBlack::getGreeks(forwards.data(), strikes.data(), maturities.data(), sigmas.data(), isCallBuffer.get(), forwards.size(), greeks);
+    for (std::size_t j = 0; j < forwards.size(); ++j)
+    {
+        UndiscountedBlack::Greeks g = UndiscountedBlack::getGreeks(forwards[j], strikes[j], maturities[j], sigmas[j], isCall[j]);
+        assert(greeks.price_[j] == g.price_ && greeks.delta_[j] == g.delta_ && greeks.gamma_[j] == g.gamma_);
+        assert(greeks.vega_[j] == g.vega_ && greeks.theta_[j] == g.theta_ && greeks.vanna_[j] == g.vanna_);
+        assert(greeks.volga_[j] == g.volga_ && greeks.charm_[j] == g.charm_ && greeks.veta_[j] == g.veta_);
+    }
+
+    // Vanishing volatility: intrinsic value, the at-the-money delta is the limit 1/2 of N(d1)
+    for (double s: {0.0, 1e-320})
+    {
+        UndiscountedBlack::Greeks atm = UndiscountedBlack::getGreeks(100.0, 100.0, 1.0, s, true), put = UndiscountedBlack::getGreeks(100.0, 100.0, 1.0, s, false);
+        assert(atm.price_ == 0.0 && atm.delta_ == .5 && put.price_ == 0.0 && put.delta_ == -.5);
+        UndiscountedBlack::Greeks itm = UndiscountedBlack::getGreeks(100.0, 90.0, 1.0, s, true), otm = UndiscountedBlack::getGreeks(100.0, 90.0, 1.0, s, false);
+        assert(itm.price_ == 10.0 && itm.delta_ == 1.0 && otm.price_ == 0.0 && otm.delta_ == 0.0 && itm.gamma_ == 0.0 && itm.theta_ == 0.0);
+    }
+    std::cout << "Undiscounted Black Greeks Passed! (Scalar and batch kernels against bump-and-reprice)"<<std::endl;
+}
+
 void testHestonLewisPrices()
 {
     // Test Heston model
@@ -61,10 +139,182 @@ void testHestonLewisPrices()
     double modelHestonPrice = sqrt(F*K)*Heston::getUndiscountedLewisPrice(log(F/K),T,heston,true,quad)*exp(-r*T);
     assert(isClose(modelHestonPrice, expectedHestonPrice, 1e-4));
 
+    // The prefolded plan must reproduce the quadrature path and put-call parity on both sides of the money
+    BlackTools::LewisQuadraturePlan plan(quad);
+    for (double k = 50; k <= 150; k += 10)
+    {
+        double x = log(F/k);
+        double callPrice = Heston::getUndiscountedLewisPrice(x,T,heston,true,plan);
+        double putPrice = Heston::getUndiscountedLewisPrice(x,T,heston,false,plan);
+        assert(isClose(callPrice, Heston::getUndiscountedLewisPrice(x,T,heston,true,quad), 1e-12));
+        assert(isClose(callPrice - putPrice, exp(.5*x) - exp(-.5*x), 1e-12));
+        assert(isClose(UndiscountedBlack::getLewisPrice(x,0.3,false,plan), UndiscountedBlack::getPrice(x,0.3,false), 1e-6));
+    }
+
+    // Surface pricer shares the characteristic function across strikes of a maturity
+    std::vector<double> maturities = {0.1, 0.5, 1.0, 1.5, 3.0, 5.0};
+    std::vector<double> forwards, strikes;
+    for (double t: maturities) forwards.push_back(S * std::exp((r - q) * t));
+    for (double k = 50; k <= 200; k += 5) strikes.push_back(k);
+    Heston::Surface surface = Heston::getUndiscountedLewisSurface(forwards, maturities, strikes, heston, plan);
+    for (std::size_t m = 0; m < maturities.size(); ++m)
+    {
+        for (std::size_t k = 0; k < strikes.size(); ++k)
+        {
+            double expectedPrice = sqrt(forwards[m]*strikes[k])*Heston::getUndiscountedLewisPrice(log(forwards[m]/strikes[k]),maturities[m],heston,true,plan);
+            double expectedVol = Heston::getImpliedVolatility(forwards[m],strikes[k],maturities[m],heston,plan);
+            assert(isClose(surface.undiscountedPrices_[m][k], expectedPrice, 1e-10));
+            if (!std::isnan(expectedVol)) assert(isClose(surface.impliedVolatilities_[m][k], expectedVol, 1e-10));
+        }
+    }
+
+    // Strike-grid engines against the 64-point Lewis reference
+    std::vector<double> x;
+    for (double k: strikes) x.push_back(log(F/k));
+    std::function<std::complex<double>(std::complex<double>)> cf = [T, &heston](std::complex<double> u) {return Heston::getCharacteristicFunction(u, T, heston);};
+    for (bool c: {true, false})
+    {
+        std::vector<double> cosPrices = BlackTools::COSEngine(128).getUndiscountedPrices(x, c, cf);
+        std::vector<double> fftPrices = BlackTools::CarrMadanEngine(4096).getUndiscountedPrices(x, c, cf);
+        for (std::size_t j = 0; j < x.size(); ++j)
+        {
+            double expectedPrice = Heston::getUndiscountedLewisPrice(x[j],T,heston,c,plan);
+            assert(isClose(cosPrices[j], expectedPrice, 1e-6));
+            assert(isClose(fftPrices[j], expectedPrice, 1e-6));
+        }
+    }
+
     std::cout << "The test of the undiscounted normalized Heston Lewis price fucntion is Passed!\n";
 
 }
 
+void testAdaptiveLewisQuadrature()
+{
+    BlackTools::AdaptiveLewisQuadrature adaptive(1e-8);
+    // Closed-form Black prices: every quote meets the tolerance, the node count follows maturity and moneyness
+    std::map<std::pair<double, double>, std::size_t> nodes;
+    for (double s: {0.02, 0.1, 0.5, 2.0})
+    {
+        for (double x: {-0.5, -0.1, 0.0, 0.1, 0.5})
+        {
+            auto cf = [x, s](std::complex<double> u) {return UndiscountedBlack::getCharacteristicFunction(u, x, s);};
+            for (bool isCall: {true, false})
+            {
+                BlackTools::AdaptiveLewisResult result = adaptive.getUndiscountedPrice(x, isCall, cf);
+                assert(result.converged_ && result.errorEstimate_ <= 1e-8 && result.nodes_ > 0 && result.evaluations_ >= result.nodes_);
+                assert(isClose(result.price_, UndiscountedBlack::getPrice(x, s, isCall), 1e-8));
+                // Every Kronrod node is a characteristic function call, the 7 Gauss nodes are shared
+                assert(result.method_ == BlackTools::LewisQuadratureMethod::GAUSS_LAGUERRE || result.nodes_ % 15 == 0);
+                nodes[{s, x}] = result.nodes_;
+            }
+        }
+    }
+    assert((nodes[{2.0, 0.0}] < nodes[{0.02, 0.0}] && nodes[{0.02, 0.0}] < nodes[{0.02, -0.5}]));
+    assert(adaptive.getCachedOrders() > 0);
+
+    // Heston against the 64-point reference, which is accurate for these maturities
+    Heston::Parameters heston(2.0,0.05,0.3,0.45,0.05);
+    BlackTools::LewisQuadraturePlan plan(64);
+    BlackTools::AdaptiveLewisQuadrature loose(1e-6);
+    for (double T: {0.25, 1.5, 5.0})
+    {
+        auto cf = [T, &heston](std::complex<double> u) {return Heston::getCharacteristicFunction(u, T, heston);};
+        for (double x = -0.4; x <= 0.4; x += 0.2)
+        {
+            BlackTools::AdaptiveLewisResult result = loose.getUndiscountedPrice(x, true, cf);
+            assert(result.converged_ && isClose(result.price_, Heston::getUndiscountedLewisPrice(x,T,heston,true,plan), 2e-6));
+        }
+    }
+    // Cached orders are reused: the same quote gives the same price without new entries
+    const std::size_t cached = loose.getCachedOrders();
+    auto cf = [&heston](std::complex<double> u) {return Heston::getCharacteristicFunction(u, 1.5, heston);};
+    assert(loose.getUndiscountedPrice(0.1, true, cf).price_ == loose.getUndiscountedPrice(0.1, true, cf).price_ && loose.getCachedOrders() == cached);
+    std::cout << "Adaptive Lewis quadrature Passed!" << std::endl;
+}
+
+void testHestonCharacteristicKernelCache()
+{
+    double F = 100*exp(0.06), T = 1.5;
+    BlackTools::LewisQuadraturePlan plan(64);
+    Heston::CharacteristicKernelCache cache(plan);
+    // theta/v0 sweep on a strike grid: a single kernel is built for the whole scenario set
+    for (double theta = 0.02; theta <= 0.1; theta += 0.02)
+    {
+        for (double v0 = 0.02; v0 <= 0.1; v0 += 0.02)
+        {
+            Heston::Parameters heston(2.0,theta,0.3,0.45,v0);
+            for (double K = 60; K <= 140; K += 20)
+            {
+                double expectedPrice = Heston::getUndiscountedLewisPrice(log(F/K),T,heston,true,plan);
+                assert(isClose(cache.getUndiscountedLewisPrice(log(F/K),T,heston,true), expectedPrice, 1e-13));
+            }
+        }
+    }
+    assert(cache.getMisses() == 1 && cache.getSize() == 1);
+    assert(cache.getHits() == 124);
+    cache.getKernel(2.0, Heston::Parameters(2.0,0.05,0.3,0.45,0.05));
+    assert(cache.getMisses() == 2 && cache.getSize() == 2);
+
+    // Least recently used kernel evicted at capacity, a kernel in use outlives its eviction and the plan of the caller
+    std::shared_ptr<const Heston::CharacteristicKernel> kernel;
+    Heston::Parameters heston(2.0,0.05,0.3,0.45,0.05);
+    double expectedPrice = Heston::getUndiscountedLewisPrice(log(F/100), 0.5, heston, true, plan);
+    {
+        BlackTools::LewisQuadraturePlan scopedPlan(64);
+        Heston::CharacteristicKernelCache boundedCache(scopedPlan, 2);
+        kernel = boundedCache.getKernel(0.5, heston);
+        boundedCache.getKernel(1.0, heston);
+        boundedCache.getKernel(0.5, heston);
+        boundedCache.getKernel(2.0, heston);
+        assert(boundedCache.getSize() == 2 && boundedCache.getMisses() == 3 && boundedCache.getHits() == 1);
+        boundedCache.getKernel(0.5, heston);
+        assert(boundedCache.getHits() == 2);
+        boundedCache.getKernel(1.0, heston);
+        assert(boundedCache.getMisses() == 4 && boundedCache.getSize() == 2);
+        boundedCache.clear();
+    }
+    assert(isClose(kernel->getUndiscountedLewisPrice(log(F/100), heston.theta_, heston.v0_, true), expectedPrice, 1e-13));
+    std::cout << "Heston characteristic function kernel cache Passed!" << std::endl;
+}
+
+void testHestonCalibration()
+{
+    Heston::Parameters heston(2.0,0.05,0.3,-0.45,0.04);
+
+    // Analytic characteristic function gradient against central differences
+    std::complex<double> u(1.3,-0.5);
+    std::array<std::complex<double>, 5> gradient = Heston::getCharacteristicFunctionGradient(u, 1.5, heston);
+    for (int p = 0; p < 5; ++p)
+    {
+        std::array<double, 5> up = {heston.kappa_, heston.theta_, heston.eta_, heston.rho_, heston.v0_}, down = up;
+        up[p] += 1e-6; down[p] -= 1e-6;
+        std::complex<double> fd = (Heston::getCharacteristicFunction(u, 1.5, Heston::Parameters(up[0],up[1],up[2],up[3],up[4])) - 
+            Heston::getCharacteristicFunction(u, 1.5, Heston::Parameters(down[0],down[1],down[2],down[3],down[4])))/2e-6;
+        assert(std::abs(gradient[p] - fd) <= 1e-8);
+    }
+
+    // 200 quotes generated by the model are fitted back from a distant initial guess
+    BlackTools::LewisQuadraturePlan plan(64);
+    std::vector<Heston::CalibrationQuote> quotes;
+    for (double T: {0.1, 0.25, 0.5, 0.75, 1.0, 1.5, 2.0, 3.0, 5.0, 10.0})
+    {
+        double F = 100*exp(0.02*T);
+        for (int k = 0; k < 20; ++k)
+        {
+            double K = F*exp(sqrt(T)*(-0.5 + k/19.0));
+            quotes.emplace_back(F, K, T, Heston::getImpliedVolatility(F, K, T, heston, plan), true);
+        }
+    }
+    Heston::Calibration calibration(quotes, plan);
+    Heston::Parameters fitted = calibration.calibrate(Heston::Parameters(1.0,0.1,0.5,0.0,0.1));
+    assert(isClose(fitted.kappa_, heston.kappa_, 1e-5));
+    assert(isClose(fitted.theta_, heston.theta_, 1e-6));
+    assert(isClose(fitted.eta_, heston.eta_, 1e-6));
+    assert(isClose(fitted.rho_, heston.rho_, 1e-6));
+    assert(isClose(fitted.v0_, heston.v0_, 1e-6));
+    std::cout << "Heston calibration Passed! (" << calibration.getIterations() << " Levenberg-Marquardt iterations)" << std::endl;
+}
+
 void testSolveNewtonNormalizedVolatility() 
 {
     std::cout << "Testing get_newton_normalized_volatility..." << std::endl;
@@ -85,6 +335,51 @@ void testSolveNewtonNormalizedVolatility()
     std::cout << "All tests passed for Newton implied normalized volatility solver!" << std::endl;
 }
 
+void testRationalCubicInitialGuess()
+{
+    std::cout << "Testing rational cubic initial guess..." << std::endl;
+    // Shape-preserving minimum of the control parameter: monotone convex data, data with no shape to preserve
+    assert(ImpliedVolatilitySolver::getMinimumR(1, 3, 2, false) == 2);
+    assert(ImpliedVolatilitySolver::getMinimumR(1, -1, 2, false) == ImpliedVolatilitySolver::minR);
+    const double r = ImpliedVolatilitySolver::getMinimumR(.01, 10, 1, false);
+    for (double t = 0, previous = 0; t <= 1; t += 1.0/64)
+    {
+        const double y = ImpliedVolatilitySolver::getRationalCubicInterpolate(t, 0, 1, 0, 1, .01, 10, r);
+        assert(y >= previous);
+        previous = y;
+    }
+    // Without the clamp to the minimum the asymptotic control parameter of the central-right branch makes the guess NaN here
+    const double x = -4.4;
+    for (double s = 1.50; s < 1.56; s += .002)
+    {
+        const double b = UndiscountedBlack::getPrice(x, s, true);
+        const double guess = ImpliedVolatilitySolver::getInitialGuess(b, x, true);
+        assert(std::isfinite(guess) and abs(guess - s) <= 1e-3*s);
+        assert(abs(ImpliedVolatilitySolver::getHouseholderNormalizedVolatility(b, x, true) - s) <= 1e-12*s);
+    }
+    std::cout << "All tests passed for rational cubic initial guess!" << std::endl;
+}
+
+void testHouseholderNormalizedVolatility() 
+{
+    std::cout << "Testing get_householder_normalized_volatility..." << std::endl;
+    for (double s = 0.01; s < 7; s+= .5)
+    {
+        for (double x = -10; x<=10; x+=0.5)
+        {
+            for (bool c: {true, false})
+            {
+                double b = UndiscountedBlack::getPrice(x,s,c); 
+                // In the money the time value is lost in the intrinsic value, so compare to the Newton solver rather than to s
+                double s_lbr = ImpliedVolatilitySolver::getHouseholderNormalizedVolatility(b,x,c);
+                double s_newton = ImpliedVolatilitySolver::getNewtonNormalizedVolatility(b,x,c);
+                if (s_newton>0) assert(abs(s_lbr-s_newton)<= 1e-10*s_newton);
+            }
+        }
+    }
+    std::cout << "All tests passed for Householder (Let's be rational) implied normalized volatility solver!" << std::endl;
+}
+
 void testBlackImpliedVolatilitySolver()
 {
     double S = 100.0;    // Stock price
@@ -126,24 +421,127 @@ void testBlackImpliedVolatilitySolver2()
                 iv = ImpliedVolatilitySolver::getBlackImpliedVolatility(price,F,K,T,true);
                 vega = UndiscountedBlack::getVega(log(F/K),iv*sqrt(T));
                 expectedVega = UndiscountedBlack::getVega(log(F/K),s*sqrt(T));
-                if (!isnan(vega) and !isnan(expectedVega)) assert(abs(vega-expectedVega)<= 1e-3);
+                if (!std::isnan(vega) and !std::isnan(expectedVega)) assert(abs(vega-expectedVega)<= 1e-3);
+
+                // Puts are inverted as puts (isCall is forwarded to the normalized solver)
+                price = sqrt(F*K)*UndiscountedBlack::getPrice(log(F/K),s*sqrt(T),false); 
+                iv = ImpliedVolatilitySolver::getBlackImpliedVolatility(price,F,K,T,false);
+                vega = UndiscountedBlack::getVega(log(F/K),iv*sqrt(T));
+                if (!std::isnan(vega) and !std::isnan(expectedVega)) assert(abs(vega-expectedVega)<= 1e-3);
 
-                //price = sqrt(F*K)*UndiscountedBlack::getPrice(log(F/K),s*sqrt(T),false); 
-                //iv = ImpliedVolatilitySolver::getBlackImpliedVolatility(price,F,K,T,false);
-                //if (!isnan(iv)) assert(abs(iv-s)<= 1e-3);
-                
             }
         }
     }
     std::cout << "All tests passed for Black Implied volatility solver!" << std::endl;
 }
 
+void testBatchBlackImpliedVolatilitySolver()
+{
+    std::cout << "Testing batch Black implied volatility solver..." << std::endl;
+    double S = 100; 
+    double r = 0.01; 
+    double q = 0.02; 
+    std::vector<double> prices, forwards, strikes, maturities, normalizedVolatilities; 
+    std::vector<char> isCall;
+    for (double K = 1; K <= 500; K+= 10)
+    {
+        for (double T = 0.001; T <=30; T+= 0.5)
+        {
+            for (double s= 0.01; s<=5; s+=0.1)
+            {
+                double F = S*exp((r-q)*T);
+                for (bool c: {true, false})
+                {
+                    prices.push_back(sqrt(F*K)*UndiscountedBlack::getPrice(log(F/K),s*sqrt(T),c)); 
+                    forwards.push_back(F); 
+                    strikes.push_back(K); 
+                    maturities.push_back(T); 
+                    isCall.push_back(c);
+                    normalizedVolatilities.push_back(s*sqrt(T));
+                }
+            }
+        }
+    }
+    std::unique_ptr<bool[]> isCallBuffer(new bool[isCall.size()]);
+    for (std::size_t j = 0; j < isCall.size(); ++j) isCallBuffer[j] = isCall[j];
+    std::vector<double> ivs(prices.size());
+    ImpliedVolatilitySolver::getBlackImpliedVolatilities(
+        prices.data(), forwards.data(), strikes.data(), maturities.data(), isCallBuffer.get(), prices.size(), ivs.data());
+    for (std::size_t j = 0; j < prices.size(); ++j)
+    {
+        double iv = ImpliedVolatilitySolver::getBlackImpliedVolatility(prices[j], forwards[j], strikes[j], maturities[j], isCall[j]);
+        if (std::isnan(iv)) assert(std::isnan(ivs[j]));
+        else assert(abs(iv-ivs[j])<= 1e-12);
+    }
+    // Let's be rational mode: the Householder steps run lane-wise on the vector Black kernels. Compared to the scalar solver on the
+    // domain of testHouseholderNormalizedVolatility, above it the quotes sit at the no-arbitrage bound within rounding and both results are noise
+    ImpliedVolatilitySolver::getBlackImpliedVolatilities(
+        prices.data(), forwards.data(), strikes.data(), maturities.data(), isCallBuffer.get(), prices.size(), ivs.data(), 
+        ImpliedVolatilitySolver::SolverMethod::LETS_BE_RATIONAL);
+    for (std::size_t j = 0; j < prices.size(); ++j)
+    {
+        if (normalizedVolatilities[j] >= 7) continue;
+        double iv = ImpliedVolatilitySolver::getBlackImpliedVolatility(
+            prices[j], forwards[j], strikes[j], maturities[j], isCall[j], ImpliedVolatilitySolver::SolverMethod::LETS_BE_RATIONAL);
+        if (std::isnan(iv)) assert(std::isnan(ivs[j]));
+        else assert(abs(iv-ivs[j])<= 1e-12*iv);
+    }
+    // A call above the forward has no implied volatility: NaN in the batch as in the scalar solver
+    const double price = 2*forwards[0], iv = ImpliedVolatilitySolver::getBlackImpliedVolatility(price, forwards[0], strikes[0], 1.0, true);
+    double batchIv = 0;
+    const bool call = true;
+    ImpliedVolatilitySolver::getBlackImpliedVolatilities(&price, &forwards[0], &strikes[0], &maturities[0], &call, 1, &batchIv);
+    assert(std::isnan(iv) && std::isnan(batchIv));
+    std::cout << "All tests passed for batch Black implied volatility solver!" << std::endl;
+}
+
+void testChebyshevImpliedVolatility()
+{
+    std::cout << "Testing Chebyshev implied volatility interpolant..." << std::endl;
+    ImpliedVolatilitySolver::ChebyshevInterpolant interpolant;
+    std::cout << "Table: " << interpolant.getTiles() << " tiles, " << interpolant.getTableSize() << " coefficients, built in "
+        << interpolant.getBuildTime() << "s, maximum relative error " << interpolant.getMaximumError() << std::endl;
+    assert(interpolant.getTableSize() == interpolant.getTiles()*interpolant.getOrder()*interpolant.getOrder());
+    assert(interpolant.getMaximumError() > 0 and interpolant.getMaximumError() < 1e-4);
+    for (double s = 0.01; s < 3; s+= .1)
+    {
+        for (double xi = -20; xi <= 20; xi += 0.7)
+        {
+            for (bool c: {true, false})
+            {
+                double x = xi*s, b = UndiscountedBlack::getPrice(x,s,c);
+                // Out of the money only, in the money the time value is lost in the intrinsic value
+                if ((c and x > 0) or (!c and x < 0)) continue;
+                double raw = interpolant.getNormalizedVolatility(b,x,c,false);
+                double polished = interpolant.getNormalizedVolatility(b,x,c,true);
+                assert(abs(raw-s) <= 2*interpolant.getMaximumError()*s);
+                assert(abs(polished-s) <= 1e-12*s);
+            }
+        }
+    }
+    // Outside of the table the interpolant falls back to the Householder solver
+    double b = UndiscountedBlack::getPrice(-1.0,0.001,true);
+    assert(interpolant.getNormalizedVolatility(b,-1.0,true,false) == ImpliedVolatilitySolver::getHouseholderNormalizedVolatility(b,-1.0,true));
+    double F = 105, K = 100, T = 2, price = sqrt(F*K)*UndiscountedBlack::getPrice(log(F/K),0.3*sqrt(T),false);
+    assert(isClose(interpolant.getBlackImpliedVolatility(price,F,K,T,false,true), 0.3, 1e-12));
+    std::cout << "All tests passed for Chebyshev implied volatility interpolant!" << std::endl;
+}
+
 int main()
 {
     testUndiscountedBlack(); 
+    testUndiscountedBlackBatchPrices(); 
+    testUndiscountedBlackGreeks(); 
     testSolveNewtonNormalizedVolatility(); 
+    testRationalCubicInitialGuess();
+    testHouseholderNormalizedVolatility(); 
     testHestonLewisPrices(); 
+    testAdaptiveLewisQuadrature(); 
+    testHestonCharacteristicKernelCache(); 
+    testHestonCalibration(); 
     testBlackImpliedVolatilitySolver();
     testBlackImpliedVolatilitySolver2();
+    testBatchBlackImpliedVolatilitySolver();
+    testChebyshevImpliedVolatility();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include "../include/cpp-quant/tools/finitedifference.hpp"
+
+bool isClose(double a, double b, double tol) {return std::abs(a - b) <= tol;}
+
+// Discounted Black-Scholes premium in spot, rate and dividend yield
+double getBlackScholesPrice(double S, double K, double T, double r, double q, double sigma, bool isCall)
+{
+    double F = S*exp((r - q)*T);
+    return exp(-r*T)*sqrt(F*K)*UndiscountedBlack::getPrice(log(F/K), sigma*sqrt(T), isCall);
+}
+
+void testBlackGrid()
+{
+    double S = 100, T = 1, r = .05, q = .02, sigma = .2;
+    std::vector<double> strikes = {70, 80, 90, 100, 110, 120, 130};
+    FiniteDifference::BlackGrid grid(S, T, r, q, sigma, 201, 100);
+    for (bool c: {true, false})
+    {
+        std::vector<FiniteDifference::Greeks> greeks = grid.getPrices(strikes, c, FiniteDifference::Exercise::EUROPEAN);
+        for (std::size_t k = 0; k < strikes.size(); ++k)
+        {
+            double K = strikes[k], bump = 1e-2;
+            double price = getBlackScholesPrice(S, K, T, r, q, sigma, c);
+            double up = getBlackScholesPrice(S + bump, K, T, r, q, sigma, c), down = getBlackScholesPrice(S - bump, K, T, r, q, sigma, c);
+            double later = getBlackScholesPrice(S, K, T - 1e-4, r, q, sigma, c);
+            assert(isClose(greeks[k].price_, price, 3e-3));
+            assert(isClose(greeks[k].delta_, (up - down)/(2*bump), 5e-4));
+            assert(isClose(greeks[k].gamma_, (up - 2*price + down)/(bump*bump), 1e-4));
+            assert(isClose(greeks[k].theta_, (later - price)/1e-4, 2e-2));
+            // One strike alone goes through the same arithmetic
+            assert(isClose(grid.getPrices({K}, c, FiniteDifference::Exercise::EUROPEAN)[0].price_, greeks[k].price_, 1e-12));
+        }
+    }
+    std::cout << "Black Crank-Nicolson grid Passed!" << std::endl;
+}
+
+void testBlackGridEarlyExercise()
+{
+    double S = 100, T = 1, r = .05, sigma = .2;
+    std::vector<double> strikes = {90, 100, 110};
+    FiniteDifference::BlackGrid grid(S, T, r, 0.0, sigma, 401, 200);
+    std::vector<FiniteDifference::Greeks> penalty = grid.getPrices(strikes, false, FiniteDifference::Exercise::AMERICAN);
+    grid.setExerciseMethod(FiniteDifference::ExerciseMethod::PSOR);
+    std::vector<FiniteDifference::Greeks> psor = grid.getPrices(strikes, false, FiniteDifference::Exercise::AMERICAN);
+    std::vector<FiniteDifference::Greeks> european = grid.getPrices(strikes, false, FiniteDifference::Exercise::EUROPEAN);
+    // Quarterly exercise, and a single exercise date at maturity which is the European option
+    std::vector<FiniteDifference::Greeks> bermudan = grid.getPrices(strikes, false, FiniteDifference::Exercise::BERMUDAN, {.25, .5, .75});
+    std::vector<FiniteDifference::Greeks> atMaturity = grid.getPrices(strikes, false, FiniteDifference::Exercise::BERMUDAN, {T});
+    for (std::size_t k = 0; k < strikes.size(); ++k)
+    {
+        assert(isClose(penalty[k].price_, psor[k].price_, 1e-6));
+        assert(european[k].price_ < bermudan[k].price_ and bermudan[k].price_ < penalty[k].price_);
+        assert(atMaturity[k].price_ == european[k].price_);
+    }
+    // Binomial reference of the at-the-money American put (Hull, 6.0904)
+    assert(isClose(penalty[1].price_, 6.0904, 2e-3));
+    assert(penalty[1].delta_ < 0 and penalty[1].gamma_ > 0);
+
+    // Without dividends the American call is never exercised early
+    std::vector<FiniteDifference::Greeks> americanCall = grid.getPrices(strikes, true, FiniteDifference::Exercise::AMERICAN);
+    for (std::size_t k = 0; k < strikes.size(); ++k) assert(isClose(americanCall[k].price_, getBlackScholesPrice(S, strikes[k], T, r, 0.0, sigma, true), 1e-3));
+    std::cout << "Black American and Bermudan exercise Passed!" << std::endl;
+}
+
+void testHestonGrid()
+{
+    double S = 100, T = 1, r = .05, q = .02;
+    Heston::Parameters heston(2.0,0.05,0.3,-0.45,0.05);
+    BlackTools::LewisQuadraturePlan plan(64);
+    std::vector<double> strikes = {80, 90, 100, 110, 120};
+    FiniteDifference::HestonGrid grid(S, T, r, q, heston, 101, 50, 50);
+    auto getLewisPrice = [&](double spot, double K, bool c)
+    {
+        double F = spot*exp((r - q)*T);
+        return exp(-r*T)*sqrt(F*K)*Heston::getUndiscountedLewisPrice(log(F/K), T, heston, c, plan);
+    };
+    for (bool c: {true, false})
+    {
+        std::vector<FiniteDifference::Greeks> greeks = grid.getPrices(strikes, c, FiniteDifference::Exercise::EUROPEAN);
+        for (std::size_t k = 0; k < strikes.size(); ++k)
+        {
+            double K = strikes[k];
+            assert(isClose(greeks[k].price_, getLewisPrice(S, K, c), 2e-2));
+            assert(isClose(greeks[k].delta_, (getLewisPrice(S + .5, K, c) - getLewisPrice(S - .5, K, c)), 2e-3));
+            assert(isClose(greeks[k].gamma_, (getLewisPrice(S + .5, K, c) - 2*getLewisPrice(S, K, c) + getLewisPrice(S - .5, K, c))/.25, 5e-4));
+        }
+    }
+    std::vector<FiniteDifference::Greeks> european = grid.getPrices(strikes, false, FiniteDifference::Exercise::EUROPEAN);
+    std::vector<FiniteDifference::Greeks> american = grid.getPrices(strikes, false, FiniteDifference::Exercise::AMERICAN);
+    std::vector<FiniteDifference::Greeks> bermudan = grid.getPrices(strikes, false, FiniteDifference::Exercise::BERMUDAN, {.5});
+    for (std::size_t k = 0; k < strikes.size(); ++k)
+    {
+        assert(european[k].price_ < bermudan[k].price_ and bermudan[k].price_ < american[k].price_);
+        assert(american[k].price_ >= strikes[k] - S);
+    }
+    std::cout << "Heston ADI grid Passed!" << std::endl;
+}
+
+int main()
+{
+    testBlackGrid();
+    testBlackGridEarlyExercise();
+    testHestonGrid();
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <cmath>
+#include <memory>
+#include "../include/cpp-quant/tools/metrics.hpp"
+#include "../include/cpp-quant/tools/black.hpp"
+
+using Metrics::Counter;
+using Metrics::Histogram;
+
+void testMetricsBuckets()
+{
+    assert(Metrics::getBucket(0.0) == 0);
+    assert(Metrics::getBucket(0.5) == 0);
+    assert(Metrics::getBucket(1.0) == 1);
+    assert(Metrics::getBucket(3.0) == 2);
+    assert(Metrics::getBucket(4.0) == 3);
+    assert(Metrics::getBucket(1e300) == Metrics::HISTOGRAM_BUCKETS - 1);
+    assert(Metrics::getBucket(NAN) == 0);
+}
+
+void testMetricsSnapshot()
+{
+    Metrics::reset();
+    Metrics::increment(Counter::LEWIS_PRICES);
+    Metrics::increment(Counter::LEWIS_PRICES, 4);
+    for (int k = 1; k <= 100; ++k) Metrics::record(Histogram::IMPLIED_VOLATILITY_ITERATIONS, k);
+
+    Metrics::Snapshot snapshot = Metrics::getSnapshot();
+    assert(snapshot.getCounter(Counter::LEWIS_PRICES) == 5);
+    assert(snapshot.getCounter(Counter::NSS_OLS_FITS) == 0);
+    const Metrics::HistogramSnapshot& iterations = snapshot.getHistogram(Histogram::IMPLIED_VOLATILITY_ITERATIONS);
+    assert(iterations.count_ == 100);
+    assert(iterations.sum_ == 5050.0);
+    assert(iterations.min_ == 1.0 and iterations.max_ == 100.0);
+    assert(iterations.getMean() == 50.5);
+    // Quantiles are bucket upper bounds, within a factor 2 of the exact value
+    assert(iterations.getPercentile(.5) >= 50.0 and iterations.getPercentile(.5) <= 100.0);
+    assert(iterations.getPercentile(.99) == 100.0);
+    assert(std::isnan(snapshot.getHistogram(Histogram::SVENSSON_CALIBRATION_MICROSECONDS).getMean()));
+
+    {
+        Metrics::ScopedTimer timer(Histogram::SVENSSON_CALIBRATION_MICROSECONDS);
+    }
+    assert(Metrics::getSnapshot().getHistogram(Histogram::SVENSSON_CALIBRATION_MICROSECONDS).count_ == 1);
+
+    Metrics::reset();
+    snapshot = Metrics::getSnapshot();
+    assert(snapshot.getCounter(Counter::LEWIS_PRICES) == 0);
+    assert(snapshot.getHistogram(Histogram::IMPLIED_VOLATILITY_ITERATIONS).count_ == 0);
+}
+
+void testMetricsThreads()
+{
+    Metrics::reset();
+    const int threads = 8, increments = 10000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([t]() {
+            for (int k = 0; k < increments; ++k) Metrics::increment(Counter::BLACK_REGION3);
+            Metrics::record(Histogram::DISCOUNT_CURVE_CALIBRATION_MICROSECONDS, t + 1);
+        });
+
+    // A thread kept alive holds a live shard, the others are merged into the registry when they exit
+    std::thread live;
+    bool ready = false, done = false;
+    std::mutex mutex;
+    std::condition_variable condition;
+    live = std::thread([&]() {
+        Metrics::increment(Counter::BLACK_REGION3, 7);
+        std::unique_lock<std::mutex> lock(mutex);
+        ready = true;
+        condition.notify_all();
+        condition.wait(lock, [&]() {return done;});
+    });
+    for (std::thread& worker: workers) worker.join();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&]() {return ready;});
+    }
+
+    Metrics::Snapshot snapshot = Metrics::getSnapshot();
+    assert(snapshot.getCounter(Counter::BLACK_REGION3) == std::uint64_t(threads)*increments + 7);
+    const Metrics::HistogramSnapshot& histogram = snapshot.getHistogram(Histogram::DISCOUNT_CURVE_CALIBRATION_MICROSECONDS);
+    assert(histogram.count_ == std::uint64_t(threads));
+    assert(histogram.min_ == 1.0 and histogram.max_ == double(threads));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    condition.notify_all();
+    live.join();
+    assert(Metrics::getSnapshot().getCounter(Counter::BLACK_REGION3) == std::uint64_t(threads)*increments + 7);
+}
+
+void testMetricsExport()
+{
+    Metrics::reset();
+    Metrics::increment(Counter::IMPLIED_VOLATILITY_CALLS, 3);
+    Metrics::record(Histogram::IMPLIED_VOLATILITY_ITERATIONS, 4.0);
+    Metrics::Snapshot snapshot = Metrics::getSnapshot();
+
+    const std::string json = snapshot.toJson();
+    assert(json.front() == '{' and json.back() == '}');
+    assert(json.find("\"implied_volatility_calls\": 3") != std::string::npos);
+    assert(json.find("\"implied_volatility_iterations\": {\"count\": 1, \"sum\": 4, \"min\": 4, \"max\": 4") != std::string::npos);
+    assert(json.find("\"svensson_calibration_us\": {\"count\": 0, \"sum\": 0, \"buckets\"") != std::string::npos);
+
+    const std::string text = snapshot.toText();
+    assert(text.find("implied_volatility_calls 3\n") != std::string::npos);
+    assert(text.find("implied_volatility_iterations count=1 mean=4") != std::string::npos);
+    assert(text.find("lewis_prices 0\n") != std::string::npos);
+}
+
+void testMetricsInstrumentation()
+{
+    Metrics::reset();
+    const std::size_t n = 64;
+    std::vector<double> x(n), s(n), prices(n);
+    std::unique_ptr<bool[]> isCall(new bool[n]);
+    for (std::size_t i = 0; i < n; ++i) {x[i] = -1.0 + 2.0*i/n; s[i] = .2 + .01*i; isCall[i] = true;}
+    UndiscountedBlack::getPrices(x.data(), s.data(), isCall.get(), n, prices.data());
+    const double F = 100.0, K = 90.0;
+    double price = std::sqrt(F*K)*UndiscountedBlack::getCallPrice(std::log(F/K), 0.3);
+    double volatility = ImpliedVolatilitySolver::getBlackImpliedVolatility(price, F, K, 1.0, true);
+    assert(std::fabs(volatility - .3) < 1e-10);
+    // Above the forward, no volatility reproduces the call price
+    assert(std::isnan(ImpliedVolatilitySolver::getBlackImpliedVolatility(2.0*F, F, K, 1.0, true)));
+
+    Metrics::Snapshot snapshot = Metrics::getSnapshot();
+    std::uint64_t regions = 0;
+    for (Counter counter: {Counter::BLACK_REGION1, Counter::BLACK_REGION2, Counter::BLACK_REGION3, Counter::BLACK_REGION4}) regions += snapshot.getCounter(counter);
+#if defined(CPP_QUANT_METRICS)
+    assert(regions >= n + 1);
+    assert(snapshot.getCounter(Counter::IMPLIED_VOLATILITY_CALLS) == 2);
+    assert(snapshot.getCounter(Counter::IMPLIED_VOLATILITY_NAN) == 1);
+    assert(snapshot.getHistogram(Histogram::IMPLIED_VOLATILITY_ITERATIONS).count_ >= 1);
+#else
+    // Instrumentation compiles to nothing
+    assert(regions == 0);
+    assert(snapshot.getCounter(Counter::IMPLIED_VOLATILITY_CALLS) == 0);
+#endif
+}
+
+int main()
+{
+    testMetricsBuckets();
+    testMetricsSnapshot();
+    testMetricsThreads();
+    testMetricsExport();
+    testMetricsInstrumentation();
+    return 0;
+}
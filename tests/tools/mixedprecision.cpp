@@ -0,0 +1,111 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <memory>
+#include "../include/cpp-quant/tools/mixedprecision.hpp"
+
+void testMixedPrecisionPrices()
+{
+    std::vector<double> x, s;
+    std::vector<char> flags;
+    for (double xi = -12.0; xi <= 12.0; xi += 0.25)
+        for (double si = 1e-3; si <= 4.0; si *= 1.2)
+            for (bool isCall: {true, false}) {x.push_back(xi); s.push_back(si); flags.push_back(isCall);}
+    const std::size_t n = x.size();
+    std::unique_ptr<bool[]> isCall(new bool[n]);
+    for (std::size_t i = 0; i < n; ++i) isCall[i] = flags[i];
+
+    // Double instantiation is the library batch path
+    std::vector<double> reference(n), prices(n);
+    UndiscountedBlack::getPrices(x.data(), s.data(), isCall.get(), n, reference.data());
+    MixedPrecision::getPrices(x.data(), s.data(), isCall.get(), n, prices.data());
+    for (std::size_t i = 0; i < n; ++i) assert(prices[i] == reference[i]);
+
+    // Float path against the double path on the time value, within the documented relative bound
+    std::vector<float> xf(x.begin(), x.end()), sf(s.begin(), s.end()), pricesf(n);
+    MixedPrecision::getPrices(xf.data(), sf.data(), isCall.get(), n, pricesf.data());
+    double worst = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double h = -std::fabs(x[i])/s[i];
+        const double timeValue = reference[i] - BlackTools::getNormalizedIntrisicValue(x[i], isCall[i]);
+        if (h < -13.0 or timeValue < 1e-30) continue;
+        const double timeValuef = double(pricesf[i]) - BlackTools::getNormalizedIntrisicValue(double(xf[i]), isCall[i]);
+        // Time value relative error scaled by the conditioning 1 + h^2, plus one float rounding of the in-the-money price
+        const double error = std::fabs(timeValuef - timeValue) - 2.4e-7*reference[i];
+        worst = std::max(worst, error/(timeValue*(1.0 + h*h)));
+        assert(error <= 1e-6*timeValue*(1.0 + h*h));
+        assert(std::fabs(MixedPrecision::getPrice(xf[i], sf[i], isCall[i]) - pricesf[i]) <= 1e-6f*std::max(1.0f, pricesf[i]));
+    }
+    std::cout << "Float batch prices (worst relative error " << worst << ") Passed!" << std::endl;
+}
+
+void testMixedPrecisionGreeks()
+{
+    std::vector<double> F, K, T, sigma;
+    for (double k = 60.0; k <= 160.0; k += 5.0)
+        for (double t: {0.05, 0.5, 2.0})
+            for (double v: {0.1, 0.3, 0.8}) {F.push_back(100.0); K.push_back(k); T.push_back(t); sigma.push_back(v);}
+    const std::size_t n = F.size();
+    std::unique_ptr<bool[]> isCall(new bool[n]);
+    for (std::size_t i = 0; i < n; ++i) isCall[i] = K[i] >= 100.0;
+
+    UndiscountedBlack::GreeksArrays reference;
+    UndiscountedBlack::getGreeks(F.data(), K.data(), T.data(), sigma.data(), isCall.get(), n, reference);
+    MixedPrecision::GreeksArrays<double> greeks;
+    MixedPrecision::getGreeks(F.data(), K.data(), T.data(), sigma.data(), isCall.get(), n, greeks);
+    std::vector<float> Ff(F.begin(), F.end()), Kf(K.begin(), K.end()), Tf(T.begin(), T.end()), sigmaf(sigma.begin(), sigma.end());
+    MixedPrecision::GreeksArrays<float> greeksf;
+    MixedPrecision::getGreeks(Ff.data(), Kf.data(), Tf.data(), sigmaf.data(), isCall.get(), n, greeksf);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        // The double path is the library batch: every Greek bit for bit
+        for (auto [a, b]: {std::pair{greeks.price_[i], reference.price_[i]}, {greeks.delta_[i], reference.delta_[i]}, {greeks.gamma_[i], reference.gamma_[i]},
+                           {greeks.vega_[i], reference.vega_[i]}, {greeks.theta_[i], reference.theta_[i]}, {greeks.vanna_[i], reference.vanna_[i]},
+                           {greeks.volga_[i], reference.volga_[i]}, {greeks.charm_[i], reference.charm_[i]}, {greeks.veta_[i], reference.veta_[i]}})
+            assert(a == b);
+        const double scale = F[i]*1e-6;
+        assert(std::fabs(greeksf.price_[i] - reference.price_[i]) <= 2e-5*reference.price_[i] + scale);
+        assert(std::fabs(greeksf.delta_[i] - reference.delta_[i]) <= 2e-5*std::fabs(reference.delta_[i]) + 1e-6);
+        assert(std::fabs(greeksf.gamma_[i] - reference.gamma_[i]) <= 2e-5*reference.gamma_[i] + 1e-6);
+        assert(std::fabs(greeksf.vega_[i] - reference.vega_[i]) <= 2e-5*reference.vega_[i] + scale);
+        assert(std::fabs(greeksf.theta_[i] - reference.theta_[i]) <= 2e-5*std::fabs(reference.theta_[i]) + scale);
+        for (auto [a, b]: {std::pair{greeksf.vanna_[i], reference.vanna_[i]}, {greeksf.volga_[i], reference.volga_[i]},
+                           {greeksf.charm_[i], reference.charm_[i]}, {greeksf.veta_[i], reference.veta_[i]}})
+            assert(std::fabs(a - b) <= 2e-5*std::fabs(b) + scale);
+    }
+    std::cout << "Float batch Greeks Passed!" << std::endl;
+}
+
+void testMixedPrecisionLewis()
+{
+    BlackTools::LewisQuadraturePlan plan(64);
+    const double T = 1.0;
+    const Heston::Parameters hestonParams(1.5, 0.04, 0.5, -0.7, 0.04);
+    std::vector<std::complex<double>> folded(plan.getNodes().size());
+    plan.getFoldedCharacteristicValues([&](std::complex<double> u) {return Heston::getCharacteristicFunction(u, T, hestonParams);}, folded.data());
+    MixedPrecision::LewisPlan<double> lewis(plan, folded.data());
+    MixedPrecision::LewisPlan<float> lewisf(plan, folded.data());
+    std::vector<float> xf;
+    for (double x = -1.0; x <= 1.0; x += 0.05) xf.push_back(float(x));
+    std::vector<float> pricesf(xf.size());
+    lewisf.getPrices(xf.data(), xf.size(), true, pricesf.data());
+    for (std::size_t i = 0; i < xf.size(); ++i)
+    {
+        const double reference = plan.getFoldedUndiscountedPrice(double(xf[i]), true, folded.data());
+        assert(std::fabs(lewis.getPrice(double(xf[i]), true) - reference) <= 1e-14);
+        assert(std::fabs(pricesf[i] - reference) <= 1e-6);
+        assert(std::fabs(lewisf.getPrice(xf[i], false) - plan.getFoldedUndiscountedPrice(double(xf[i]), false, folded.data())) <= 1e-6);
+    }
+    std::cout << "Float Lewis prices Passed!" << std::endl;
+}
+
+int main()
+{
+    testMixedPrecisionPrices();
+    testMixedPrecisionGreeks();
+    testMixedPrecisionLewis();
+    return 0;
+}
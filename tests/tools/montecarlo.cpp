@@ -0,0 +1,114 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include "../include/cpp-quant/tools/montecarlo.hpp"
+
+bool isClose(double a, double b, double tol) {return std::abs(a - b) <= tol;}
+
+void testPhilox()
+{
+    // Known answers of the Random123 reference implementation
+    std::uint32_t zeros[4] = {0, 0, 0, 0}, zeroKey[2] = {0, 0}, output[4];
+    HestonMonteCarlo::getPhiloxBlock(zeros, zeroKey, output);
+    assert(output[0] == 0x6627e8d5 and output[1] == 0xe169c58d and output[2] == 0xbc57ac4c and output[3] == 0x9b00dbd8);
+    std::uint32_t ones[4] = {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, onesKey[2] = {0xffffffff, 0xffffffff};
+    HestonMonteCarlo::getPhiloxBlock(ones, onesKey, output);
+    assert(output[0] == 0x408f276d and output[1] == 0x41c83b0e and output[2] == 0xa20bc7c6 and output[3] == 0x6d5451fd);
+
+    // Uniforms are a pure function of (seed, path, step)
+    auto [u1, u2] = HestonMonteCarlo::getUniforms(7, 123456789, 11);
+    auto [w1, w2] = HestonMonteCarlo::getUniforms(7, 123456789, 11);
+    assert(u1 == w1 and u2 == w2 and u1 > 0 and u1 < 1 and u2 > 0 and u2 < 1);
+    std::cout << "Philox counter-based generator Passed!" << std::endl;
+}
+
+void testHestonMonteCarloEuropean()
+{
+    const double F = 100.0, T = 1.0;
+    BlackTools::LewisQuadraturePlan plan(64);
+    // Feller condition satisfied (quadratic branch) and strongly violated (exponential branch)
+    for (const Heston::Parameters& heston: {Heston::Parameters(2.0,0.05,0.3,0.45,0.05), Heston::Parameters(1.5,0.04,0.8,-0.7,0.04)})
+    {
+        HestonMonteCarlo::Engine engine(heston, F, T, 25);
+        engine.setPaths(40000);
+        engine.setSeed(2024);
+        for (double K: {80.0, 100.0, 120.0})
+        {
+            for (bool c: {true, false})
+            {
+                HestonMonteCarlo::Result result = engine.getPrice(HestonMonteCarlo::EuropeanPayoff(K, c));
+                double expectedPrice = sqrt(F*K)*Heston::getUndiscountedLewisPrice(log(F/K),T,heston,c,plan);
+                // Sampling error plus the discretization bias of QE with 25 steps
+                assert(isClose(result.price_, expectedPrice, 4*result.standardError_ + 2e-3*F));
+            }
+        }
+        // Martingale correction: the forward is matched at every grid date
+        std::vector<double> paths = engine.getPaths(0, 20000, false);
+        for (std::size_t i = 0; i <= engine.getSteps(); i += 10)
+        {
+            double mean = 0.0;
+            for (std::size_t path = 0; path < 20000; ++path) mean += paths[path*(engine.getSteps() + 1) + i];
+            assert(isClose(mean/20000, F, 0.5));
+        }
+    }
+    std::cout << "Heston QE Monte Carlo against Lewis Passed!" << std::endl;
+}
+
+void testHestonMonteCarloExotics()
+{
+    const double F = 100.0, T = 1.0;
+    Heston::Parameters heston(2.0,0.05,0.3,-0.7,0.05);
+    BlackTools::LewisQuadraturePlan plan(64);
+    HestonMonteCarlo::Engine engine(heston, F, T, 24);
+    engine.setPaths(20000);
+
+    // The price does not depend on the number of threads
+    HestonMonteCarlo::AsianPayoff asian(100.0, true);
+    engine.setThreads(1);
+    HestonMonteCarlo::Result reference = engine.getPrice(asian);
+    engine.setThreads(4);
+    HestonMonteCarlo::Result parallel = engine.getPrice(asian);
+    assert(reference.price_ == parallel.price_ and reference.standardError_ == parallel.standardError_ and reference.samples_ == 20000);
+
+    // A European control on the same paths reduces the variance of the Asian
+    HestonMonteCarlo::Result controlled = engine.getPrice(asian, HestonMonteCarlo::EuropeanPayoff(100.0, true), plan);
+    assert(controlled.standardError_ < .8*reference.standardError_ and controlled.controlCoefficient_ > 0);
+    assert(isClose(controlled.price_, reference.price_, 4*reference.standardError_));
+
+    // Antithetic pairs against plain paths for the same number of payoff evaluations
+    engine.setAntithetic(false);
+    engine.setPaths(40000);
+    HestonMonteCarlo::Result plain = engine.getPrice(asian);
+    assert(isClose(plain.price_, reference.price_, 4*plain.standardError_));
+    engine.setAntithetic(true);
+    engine.setPaths(20000);
+
+    // In/out parity holds path by path
+    HestonMonteCarlo::EuropeanPayoff european(95.0, false);
+    HestonMonteCarlo::Result vanilla = engine.getPrice(european);
+    for (auto [in, out]: {std::make_pair(HestonMonteCarlo::BarrierType::UP_AND_IN, HestonMonteCarlo::BarrierType::UP_AND_OUT),
+                          std::make_pair(HestonMonteCarlo::BarrierType::DOWN_AND_IN, HestonMonteCarlo::BarrierType::DOWN_AND_OUT)})
+    {
+        double barrier = in == HestonMonteCarlo::BarrierType::UP_AND_IN ? 115.0 : 85.0;
+        HestonMonteCarlo::Result knockIn = engine.getPrice(HestonMonteCarlo::BarrierPayoff(95.0, barrier, in, false));
+        HestonMonteCarlo::Result knockOut = engine.getPrice(HestonMonteCarlo::BarrierPayoff(95.0, barrier, out, false));
+        assert(isClose(knockIn.price_ + knockOut.price_, vanilla.price_, 1e-10));
+        assert(knockIn.price_ > 0 and knockOut.price_ > 0);
+    }
+
+    // Cliquet: 12 monthly returns in [-1%, 2%], the sum floored at 0
+    HestonMonteCarlo::Result cliquet = engine.getPrice(HestonMonteCarlo::CliquetPayoff(12, -.01, .02, 0.0, 1.0));
+    assert(cliquet.price_ > 0 and cliquet.price_ < .24);
+    // Without local caps or floors the cliquet is the sum of the returns, a martingale increment per period
+    HestonMonteCarlo::Result uncapped = engine.getPrice(HestonMonteCarlo::CliquetPayoff(12, -1e9, 1e9, -1e9, 1e9));
+    assert(isClose(uncapped.price_, 0.0, 4*uncapped.standardError_ + 1e-4));
+    std::cout << "Heston QE Monte Carlo exotic payoffs Passed!" << std::endl;
+}
+
+int main()
+{
+    testPhilox();
+    testHestonMonteCarloEuropean();
+    testHestonMonteCarloExotics();
+    return 0;
+}
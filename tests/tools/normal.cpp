@@ -0,0 +1,83 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <cmath>
+#include "../include/cpp-quant/tools/normal.hpp"
+
+bool isClose(double a, double b, double tol) {return std::abs(a - b) <= tol;}
+
+void testNormalKernels()
+{
+    for (double x = -30; x <= 8; x += 0.01)
+    {
+        // Long double references
+        long double cdf = .5L*erfcl(-x/sqrtl(2.0L)), pdf = expl(-.5L*x*x)/sqrtl(2.0L*3.14159265358979323846264338327950288L);
+        assert(isClose(NormalDistribution::getCdf(x), cdf, 1e-15*cdf));
+        assert(isClose(NormalDistribution::getPdf(x), pdf, 1e-15*pdf));
+        assert(isClose(NormalDistribution::getCdf<NormalDistribution::Accuracy::FAST>(x), cdf, 1e-7));
+    }
+    for (double x = -26; x <= 100; x += 0.01)
+    {
+        long double erfcx = expl((long double)x*x)*erfcl(x);
+        assert(isClose(NormalDistribution::getErfcx(x), erfcx, 1e-15*erfcx));
+    }
+    std::cout << "Normal cdf, pdf and erfcx kernels Passed!" << std::endl;
+}
+
+void testNormalQuantile()
+{
+    for (double p = 1e-300; p < 1; p = (p < 0.01) ? p*1.7 : p + 0.005)
+    {
+        double x = NormalDistribution::getQuantile(p), xFast = NormalDistribution::getQuantile<NormalDistribution::Accuracy::FAST>(p);
+        double q = (p < .5) ? NormalDistribution::getCdf(x) : NormalDistribution::getCdf(-x);
+        // Round trip is limited by the conditioning of the cdf, x*x ulps relative in the tail
+        assert(isClose(q, (p < .5) ? p : 1 - p, 1e-15*(1 + x*x)*std::min(p, 1 - p)));
+        assert(isClose(xFast, x, 1e-8*std::abs(x)));
+    }
+    // Edge cases of the branch-free fast tier
+    assert(NormalDistribution::getQuantile<NormalDistribution::Accuracy::FAST>(0.0) == -HUGE_VAL);
+    assert(NormalDistribution::getQuantile<NormalDistribution::Accuracy::FAST>(1.0) == HUGE_VAL);
+    assert(std::isnan(NormalDistribution::getQuantile<NormalDistribution::Accuracy::FAST>(NAN)));
+    assert(isClose(NormalDistribution::getQuantile<NormalDistribution::Accuracy::FAST>(1e-310), NormalDistribution::getQuantile(1e-310), 1e-8*38));
+
+    std::vector<double> p = {1e-10, 0.01, 0.3, 0.5, 0.9}, x(p.size()), back(p.size());
+    NormalDistribution::getQuantile(p.data(), p.size(), x.data());
+    NormalDistribution::getCdf(x.data(), x.size(), back.data());
+    for (std::size_t j = 0; j < p.size(); ++j) assert(isClose(back[j], p[j], 1e-15*(1 + x[j]*x[j])*p[j]));
+
+    // Batch kernels against the scalar ones: FAST tiers are the same code, the others are within a few ulps
+    std::vector<double> grid, probabilities;
+    for (double z = -30; z <= 8; z += 0.01) grid.push_back(z);
+    for (double q = 1e-300; q < 1; q = (q < 0.01) ? q*1.7 : q + 0.005) probabilities.push_back(q);
+    probabilities.insert(probabilities.end(), {0.0, 1.0, 1e-310});
+    std::vector<double> pdf(grid.size()), cdf(grid.size()), cdfFast(grid.size()), erfcx(grid.size());
+    std::vector<double> quantile(probabilities.size()), quantileFast(probabilities.size());
+    NormalDistribution::getPdf(grid.data(), grid.size(), pdf.data());
+    NormalDistribution::getCdf(grid.data(), grid.size(), cdf.data());
+    NormalDistribution::getCdf<NormalDistribution::Accuracy::FAST>(grid.data(), grid.size(), cdfFast.data());
+    NormalDistribution::getErfcx(grid.data(), grid.size(), erfcx.data());
+    NormalDistribution::getQuantile(probabilities.data(), probabilities.size(), quantile.data());
+    NormalDistribution::getQuantile<NormalDistribution::Accuracy::FAST>(probabilities.data(), probabilities.size(), quantileFast.data());
+    for (std::size_t j = 0; j < grid.size(); ++j)
+    {
+        const double z = grid[j];
+        assert(isClose(pdf[j], NormalDistribution::getPdf(z), 1e-15*pdf[j]));
+        assert(isClose(cdf[j], NormalDistribution::getCdf(z), 1e-15*cdf[j]));
+        assert(cdfFast[j] == NormalDistribution::getCdf<NormalDistribution::Accuracy::FAST>(z));
+        if (z >= -26) assert(isClose(erfcx[j], NormalDistribution::getErfcx(z), 1e-15*erfcx[j]));
+    }
+    for (std::size_t j = 0; j < probabilities.size(); ++j)
+    {
+        const double q = probabilities[j], reference = NormalDistribution::getQuantile(q);
+        assert(quantileFast[j] == NormalDistribution::getQuantile<NormalDistribution::Accuracy::FAST>(q));
+        assert(quantile[j] == reference or isClose(quantile[j], reference, (q < 1e-307 ? 1e-8 : 1e-14)*std::abs(reference) + 1e-15));
+    }
+    std::cout << "Normal quantile Passed! (Full and fast tiers, scalar and batch)" << std::endl;
+}
+
+int main()
+{
+    testNormalKernels();
+    testNormalQuantile();
+    return 0;
+}
@@ -7,7 +7,10 @@
 #include <map>
 #include <iomanip> 
 #include <filesystem>
+#include <cmath>
 #include "../../../include/cpp-quant/tools/nss.hpp"
+// Counts the heap allocations of the process (getFit must not allocate)
+#include "../../../benchmarks/allocationcounter.hpp"
 
 // Zero yields data of Bank of Canada as of September 24th, 2025 (https://www.bankofcanada.ca/rates/interest-rates/bond-yield-curves/)
 std::map<double, double> getCanadianZeroYieldData()
@@ -81,9 +84,343 @@ void testCanadianZeroYieldFit()
     std::cout << "Successful - find csv under build/output-test3 (canadaZeroCurveNelsonSiegel.csv and canadaZeroCurveSvensson.csv)." << std::endl;
 }
 
+double getMeanSquaredError(const std::shared_ptr<NelsonSiegelFamily>& ns, const std::map<double, double>& data, bool isSpotRate = true)
+{
+    double sum = 0.0;
+    for (const auto& d: data)
+    {
+        double estimate = isSpotRate ? ns->getRate(d.first) : ns->getInstantaneousForwardRate(d.first);
+        sum += (estimate - d.second)*(estimate - d.second);
+    }
+    return sum/data.size();
+}
+
+// Brute force over the grid of the calibration ({gridSize, 2 gridSize, ...} up to the first tau past the last maturity), the
+// taus minimizing the OLS mean squared error are those of the grid search (tau2 = 10 for Nelson-Siegel)
+std::vector<double> getBruteForceTaus(const NelsonSiegelCalibration& nsCalib, const std::map<double, double>& data, double gridSize, bool useSvensson)
+{
+    std::vector<double> taus, winner = {0.0, 10.0};
+    for (double tau = gridSize; taus.empty() or taus.back() <= data.rbegin()->first; tau += gridSize) taus.push_back(tau);
+    double best = INFINITY;
+    for (double tau1: taus)
+    {
+        if (!useSvensson)
+        {
+            double error = nsCalib.getFit(tau1, 10.0, false).meanSquaredError_;
+            if (error < best) {best = error; winner[0] = tau1;}
+            continue;
+        }
+        for (double tau2: taus)
+        {
+            double error = tau1 == tau2 ? INFINITY : nsCalib.getFit(tau1, tau2, true).meanSquaredError_;
+            if (error < best) {best = error; winner = {tau1, tau2};}
+        }
+    }
+    return winner;
+}
+
+// Same rates and forward rates at every maturity of the data
+bool isSameCurve(const std::shared_ptr<NelsonSiegelFamily>& a, const std::shared_ptr<NelsonSiegelFamily>& b, const std::map<double, double>& data)
+{
+    for (const auto& d: data)
+        if (a->getRate(d.first) != b->getRate(d.first) or a->getInstantaneousForwardRate(d.first) != b->getInstantaneousForwardRate(d.first)) return false;
+    return true;
+}
+
+void testClosedFormFit()
+{
+    std::map<double, double> data = getCanadianZeroYieldData();
+    for (bool isSpotRate: {true, false})
+    {
+        NelsonSiegelCalibration nsCalib(data, isSpotRate);
+        for (double tau1: {0.3, 1.5, 4.0, 12.0})
+            for (double tau2: {0.7, 6.0, 25.0})
+                for (bool useSvensson: {false, true})
+                {
+                    // Reference: general OLS on the design matrix and the loss of the resulting curve
+                    std::vector<double> y;
+                    std::vector<std::vector<double>> x;
+                    for (const auto& d: data)
+                    {
+                        y.push_back(d.second);
+                        if (isSpotRate) x.push_back({NelsonSiegelFamily::rateFuntion1(d.first, tau1), NelsonSiegelFamily::rateFuntion2(d.first, tau1)});
+                        else x.push_back({NelsonSiegelFamily::forwardRateFuntion1(d.first, tau1), NelsonSiegelFamily::forwardRateFuntion2(d.first, tau1)});
+                        if (useSvensson) x.back().push_back(isSpotRate ? NelsonSiegelFamily::rateFuntion2(d.first, tau2) : NelsonSiegelFamily::forwardRateFuntion2(d.first, tau2));
+                    }
+                    OrdinaryLeastSquare ols(y, x, true);
+                    std::vector<double> betas = ols.getCoefficients();
+
+                    NelsonSiegelFit fit = nsCalib.getFit(tau1, tau2, useSvensson);
+                    std::shared_ptr<NelsonSiegelFamily> curve = fit.getCurve();
+                    double sum = 0.0;
+                    for (const auto& d: data)
+                    {
+                        double estimate = isSpotRate ? curve->getRate(d.first) : curve->getInstantaneousForwardRate(d.first);
+                        sum += (estimate - d.second)*(estimate - d.second);
+                    }
+                    double scale = 1e-7*(std::fabs(ols.getIntercept()) + std::fabs(betas[0]) + std::fabs(betas[1]) + (useSvensson ? std::fabs(betas[2]) : 0.0));
+                    assert(std::fabs(fit.beta0_ - ols.getIntercept()) <= scale);
+                    assert(std::fabs(fit.beta1_ - betas[0]) <= scale);
+                    assert(std::fabs(fit.beta2_ - betas[1]) <= scale);
+                    assert(useSvensson ? std::fabs(fit.beta3_ - betas[2]) <= scale : fit.beta3_ == 0.0);
+                    assert(std::fabs(fit.meanSquaredError_ - sum/data.size()) <= 1e-8*sum/data.size() + 1e-20);
+                }
+
+        // Collinear regressors
+        assert(std::isnan(nsCalib.getFit(2.0, 2.0, true).meanSquaredError_));
+
+        std::size_t allocations = allocationCount.load();
+        double sink = 0.0;
+        for (int k = 0; k < 100; ++k) sink += nsCalib.getFit(1.0 + .01*k, 8.0, true).meanSquaredError_;
+        assert(allocationCount.load() == allocations and sink > 0.0);
+    }
+}
+
+void testDerivativeInstantaneousForwardRate()
+{
+    // Regression: the tau1 term missed its 1/tau1 factor. Taus far from 1 so that the factor shows, f'(0) = (b2 - b1)/tau1 + b3/tau2
+    NelsonSiegel nelsonSiegel(.04, -.02, .03, 4.0);
+    Svensson svensson(.035, -.01, .02, -.015, 4.0, .25);
+    assert(std::fabs(nelsonSiegel.getDerivativeInstantaneousForwardRate(0.0) - (.03 + .02)/4.0) <= 1e-15);
+    assert(std::fabs(svensson.getDerivativeInstantaneousForwardRate(0.0) - ((.02 + .01)/4.0 - .015/.25)) <= 1e-15);
+    for (double t: {.1, 1.0, 4.0, 12.0, 30.0})
+    {
+        const double h = 1e-5*t;
+        for (const NelsonSiegelFamily* curve: {static_cast<const NelsonSiegelFamily*>(&nelsonSiegel), static_cast<const NelsonSiegelFamily*>(&svensson)})
+        {
+            const double difference = (curve->getInstantaneousForwardRate(t + h) - curve->getInstantaneousForwardRate(t - h))/(2*h);
+            assert(std::fabs(curve->getDerivativeInstantaneousForwardRate(t) - difference) <= 1e-9);
+        }
+    }
+}
+
+void testBatchEvaluation()
+{
+    // Spans longer than a block, maturities from a day to far beyond exp underflow of -t/tau
+    std::vector<double> maturities;
+    for (std::size_t k = 0; k < 700; ++k) maturities.push_back(1.0/365 + .05*k);
+    maturities.push_back(1e4);
+    const std::size_t n = maturities.size();
+    std::vector<double> rates(n), forwardRates(n), derivatives(n);
+
+    std::vector<std::shared_ptr<NelsonSiegelFamily>> curves = {std::make_shared<NelsonSiegel>(.04, -.02, .03, 1.7),
+        std::make_shared<Svensson>(.035, -.01, .02, -.015, .8, 6.0)};
+    for (const std::shared_ptr<NelsonSiegelFamily>& curve: curves)
+    {
+        curve->evaluate(maturities.data(), n, rates.data(), forwardRates.data(), derivatives.data());
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            const double t = maturities[k];
+            assert(std::fabs(rates[k] - curve->getRate(t)) <= 1e-14);
+            assert(std::fabs(forwardRates[k] - curve->getInstantaneousForwardRate(t)) <= 1e-14);
+            assert(std::fabs(derivatives[k] - curve->getDerivativeInstantaneousForwardRate(t)) <= 1e-14);
+            const double h = 1e-5*t;
+            const double difference = (curve->getInstantaneousForwardRate(t + h) - curve->getInstantaneousForwardRate(t - h))/(2*h);
+            assert(std::fabs(derivatives[k] - difference) <= 1e-7);
+        }
+        // Null outputs are skipped
+        std::vector<double> only(n);
+        curve->evaluate(maturities.data(), n, nullptr, only.data(), nullptr);
+        assert(only == forwardRates);
+    }
+
+    // A curve outside the library that only implements the scalar functions gets the default evaluate
+    struct FlatCurve: NelsonSiegelFamily
+    {
+        double getRate(double) const override {return .03;}
+        double getInstantaneousForwardRate(double) const override {return .03;}
+        double getDerivativeInstantaneousForwardRate(double) const override {return 0.0;}
+        double getBeta0() const override {return .03;}
+        double getBeta1() const override {return 0.0;}
+    };
+    FlatCurve flat;
+    flat.evaluate(maturities.data(), n, rates.data(), nullptr, derivatives.data());
+    assert(rates == std::vector<double>(n, .03) and derivatives == std::vector<double>(n, 0.0));
+}
+
+void testVariableProjection()
+{
+    std::map<double, double> data = getCanadianZeroYieldData();
+    for (bool isSpotRate: {true, false})
+    {
+        NelsonSiegelCalibration nsCalib(data, isSpotRate);
+        nsCalib.setGridSize(1.5);
+
+        // From the grid winner, a handful of iterations to a stationary point at least as good as Nelder-Mead
+        std::vector<double> taus = getBruteForceTaus(nsCalib, data, 1.5, true);
+        VariableProjectionResult result = nsCalib.fitVariableProjection(taus[0], taus[1], true);
+        assert(result.converged_ and result.iterations_ <= 20);
+        assert(result.fit_.meanSquaredError_ <= nsCalib.getFit(taus[0], taus[1], true).meanSquaredError_);
+        const NelsonSiegelFit& fit = result.fit_;
+        assert(std::fabs(fit.meanSquaredError_ - nsCalib.getFit(fit.tau1_, fit.tau2_, true).meanSquaredError_) <= 1e-9*fit.meanSquaredError_);
+        for (double scale: {0.999, 1.001})
+        {
+            assert(nsCalib.getFit(fit.tau1_*scale, fit.tau2_, true).meanSquaredError_ >= fit.meanSquaredError_*(1 - 1e-9));
+            assert(nsCalib.getFit(fit.tau1_, fit.tau2_*scale, true).meanSquaredError_ >= fit.meanSquaredError_*(1 - 1e-9));
+        }
+        double nelderMeadError = getMeanSquaredError(nsCalib.fitSvensson(), data, isSpotRate);
+        nsCalib.setCalibrationMethod(NelsonSiegelCalibration::CalibrationMethod::VARIABLE_PROJECTION);
+        assert(getMeanSquaredError(nsCalib.fitSvensson(), data, isSpotRate) <= nelderMeadError*(1 + 1e-6));
+
+        double tau = getBruteForceTaus(nsCalib, data, 1.5, false)[0];
+        VariableProjectionResult nelsonSiegel = nsCalib.fitVariableProjection(tau, 10.0, false);
+        assert(nelsonSiegel.converged_ and nelsonSiegel.iterations_ <= 20 and nelsonSiegel.fit_.beta3_ == 0.0);
+        assert(nelsonSiegel.fit_.meanSquaredError_ <= nsCalib.getFit(tau, 10.0, false).meanSquaredError_);
+        std::cout << "Variable projection (" << (isSpotRate ? "spot" : "forward") << "): " << result.iterations_ << " iterations, taus "
+                  << fit.tau1_ << ", " << fit.tau2_ << ", MSE " << fit.meanSquaredError_ << " (Nelder-Mead " << nelderMeadError << ")." << std::endl;
+    }
+}
+
+void testCalibrationSession()
+{
+    std::map<double, double> data = getCanadianZeroYieldData();
+    NelsonSiegelCalibrationSession session(true, true);
+    session.setGridSize(1.5);
+    session.update(data);
+    assert(session.getLastPath() == NelsonSiegelCalibrationSession::UpdatePath::FULL);
+    const double reference = session.getFit().meanSquaredError_;
+
+    // Intraday moves: a few basis points of shift and twist, the taus are reused or moved from the previous solution
+    for (int step = 1; step <= 5; ++step)
+    {
+        std::map<double, double> quotes;
+        for (const auto& d: data) quotes[d.first] = d.second + 1e-5*step + 2e-6*step*d.first/30.0;
+        const NelsonSiegelFit& fit = session.update(quotes);
+        assert(session.getLastPath() == NelsonSiegelCalibrationSession::UpdatePath::INCREMENTAL);
+
+        // Same fit quality as a calibration from scratch, within the fallback threshold
+        NelsonSiegelCalibrationSession fresh(true, true);
+        fresh.setGridSize(1.5);
+        assert(fit.meanSquaredError_ <= 1.5*1.5*fresh.update(quotes).meanSquaredError_ + 1e-3*reference);
+        // The cached factorization gives the closed-form fit at the session taus
+        NelsonSiegelCalibration calibration(quotes, true);
+        double expected = calibration.getFit(fit.tau1_, fit.tau2_, true).meanSquaredError_;
+        assert(std::fabs(fit.meanSquaredError_ - expected) <= 1e-9*expected);
+    }
+
+    // Fewer maturities: no cached basis but still a warm start
+    std::map<double, double> sparse;
+    for (const auto& d: data) if (int(d.first*4) % 2 == 0) sparse[d.first] = d.second;
+    session.update(sparse);
+    assert(session.getLastPath() == NelsonSiegelCalibrationSession::UpdatePath::INCREMENTAL);
+
+    // A different curve shape degrades the previous fit: full path
+    std::map<double, double> humped;
+    for (const auto& d: data) humped[d.first] = .03 + .02*d.first*std::exp(-d.first/2.0) - .01*std::exp(-d.first/20.0);
+    session.update(humped);
+    assert(session.getLastPath() == NelsonSiegelCalibrationSession::UpdatePath::FULL);
+    assert(session.getFullUpdates() == 2 and session.getIncrementalUpdates() == 6);
+
+    session.reset();
+    session.update(data);
+    assert(session.getLastPath() == NelsonSiegelCalibrationSession::UpdatePath::FULL);
+    assert(std::fabs(session.getFit().meanSquaredError_ - reference) <= 1e-12*reference);
+
+    // An exact curve leaves a reference error near 0: tiny noise stays under the absolute floor instead of forcing the full path
+    Svensson exact(.035, -.01, .01, -.005, 1.5, 8.0);
+    std::map<double, double> exactData, noisy;
+    for (const auto& d: data) {exactData[d.first] = exact.getRate(d.first); noisy[d.first] = exactData[d.first] + 1e-8*std::sin(7.0*d.first);}
+    NelsonSiegelCalibrationSession exactSession(true, true);
+    exactSession.setGridSize(1.5);
+    exactSession.update(exactData);
+    exactSession.update(noisy);
+    assert(exactSession.getLastPath() == NelsonSiegelCalibrationSession::UpdatePath::INCREMENTAL and exactSession.getLastIterations() == 0);
+    exactSession.setAbsoluteTolerance(0.0);
+    exactSession.update(exactData);
+    exactSession.update(noisy);
+    assert(exactSession.getLastIterations() > 0 or exactSession.getLastPath() == NelsonSiegelCalibrationSession::UpdatePath::FULL);
+}
+
+void testBatchCalibration()
+{
+    // Synthetic history: Svensson curves with drifting parameters and a little noise, on the Canadian maturities
+    std::map<double, double> data = getCanadianZeroYieldData();
+    std::vector<double> maturities;
+    for (const auto& d: data) maturities.push_back(d.first);
+    const std::size_t curves = 24, n = maturities.size();
+    std::vector<double> yields(curves*n);
+    for (std::size_t c = 0; c < curves; ++c)
+    {
+        Svensson curve(.035 + .0005*c, -.01 + .0004*c, .01*std::sin(.3*c), -.005 + .0003*c, 1.5 + .1*c, 8.0 + .3*c);
+        for (std::size_t k = 0; k < n; ++k) yields[c*n + k] = curve.getRate(maturities[k]) + 2e-6*std::sin(7.0*k + c);
+    }
+
+    for (bool useSvensson: {true, false})
+    {
+        NelsonSiegelBatchCalibration batch(maturities, true, useSvensson);
+        batch.setGridSize(1.5);
+        assert(batch.getCachedCandidates() == 0);
+        std::vector<NelsonSiegelFit> fits = batch.fit(yields.data(), curves);
+        assert(fits.size() == curves and batch.getCachedCandidates() > 0);
+
+        // Same quality as the single-curve variable projection calibration
+        for (std::size_t c = 0; c < curves; ++c)
+        {
+            std::map<double, double> curve;
+            for (std::size_t k = 0; k < n; ++k) curve[maturities[k]] = yields[c*n + k];
+            NelsonSiegelCalibration nsCalib(curve, true);
+            nsCalib.setGridSize(1.5);
+            nsCalib.setCalibrationMethod(NelsonSiegelCalibration::CalibrationMethod::VARIABLE_PROJECTION);
+            double expected = getMeanSquaredError(useSvensson ? nsCalib.fitSvensson() : nsCalib.fitNelsonSiegel(), curve);
+            assert(fits[c].useSvensson_ == useSvensson);
+            assert(fits[c].meanSquaredError_ <= expected*(1 + 1e-6));
+            // The closed-form error comes from yy - |z|^2, for residuals 1e-7 relative to the curve it carries a few more digits of rounding
+            assert(std::fabs(getMeanSquaredError(fits[c].getCurve(), curve) - fits[c].meanSquaredError_) <= 1e-4*expected);
+        }
+
+        // Thread count does not change the fits, nested curves give the same result
+        batch.setThreads(1);
+        std::vector<NelsonSiegelFit> serial = batch.fit(yields.data(), curves);
+        std::vector<std::vector<double>> nested(curves);
+        for (std::size_t c = 0; c < curves; ++c) nested[c].assign(yields.begin() + c*n, yields.begin() + (c + 1)*n);
+        batch.setThreads(4);
+        std::vector<NelsonSiegelFit> fromNested = batch.fit(nested);
+        for (std::size_t c = 0; c < curves; ++c)
+        {
+            assert(serial[c].meanSquaredError_ == fits[c].meanSquaredError_ and serial[c].tau1_ == fits[c].tau1_);
+            assert(fromNested[c].meanSquaredError_ == fits[c].meanSquaredError_ and fromNested[c].beta0_ == fits[c].beta0_);
+        }
+    }
+}
+
+void testTauGridSearch()
+{
+    std::map<double, double> data = getCanadianZeroYieldData();
+    NelsonSiegelCalibration nsCalib(data, true);
+    nsCalib.setGridSize(1.5);
+    nsCalib.setCalibrationMethod(NelsonSiegelCalibration::CalibrationMethod::VARIABLE_PROJECTION);
+
+    // Variable projection starts from the grid winner: the calibrated curves are those started from the brute force winner
+    std::vector<double> nelsonSiegelTaus = getBruteForceTaus(nsCalib, data, 1.5, false), svenssonTaus = getBruteForceTaus(nsCalib, data, 1.5, true);
+    std::shared_ptr<NelsonSiegelFamily> nelsonSiegel = nsCalib.fitNelsonSiegel(), svensson = nsCalib.fitSvensson();
+    assert(isSameCurve(nelsonSiegel, nsCalib.fitVariableProjection(nelsonSiegelTaus[0], 10.0, false).fit_.getCurve(), data));
+    assert(isSameCurve(svensson, nsCalib.fitVariableProjection(svenssonTaus[0], svenssonTaus[1], true).fit_.getCurve(), data));
+    const double nelsonSiegelGridError = nsCalib.getFit(nelsonSiegelTaus[0], 10.0, false).meanSquaredError_;
+    const double svenssonGridError = nsCalib.getFit(svenssonTaus[0], svenssonTaus[1], true).meanSquaredError_;
+
+    // The winner does not depend on the number of threads
+    nsCalib.setThreads(1);
+    assert(isSameCurve(nsCalib.fitSvensson(), svensson, data));
+    nsCalib.setThreads(4);
+    assert(isSameCurve(nsCalib.fitSvensson(), svensson, data));
+
+    // Refinements only improve on the coarse winner
+    nsCalib.setGridRefinements(2);
+    assert(getMeanSquaredError(nsCalib.fitSvensson(), data) <= svenssonGridError*(1 + 1e-9));
+    assert(getMeanSquaredError(nsCalib.fitNelsonSiegel(), data) <= nelsonSiegelGridError*(1 + 1e-9));
+    std::cout << "Tau grid search successful (Svensson taus " << svenssonTaus[0] << ", " << svenssonTaus[1] << ")." << std::endl;
+}
+
 int main()
 {
     std::cout << "Starting test 3 - calibration procedure for Nelson Siegel and Svensson.." << std::endl;
+    testClosedFormFit();
+    testTauGridSearch();
+    testDerivativeInstantaneousForwardRate();
+    testBatchEvaluation();
+    testVariableProjection();
+    testCalibrationSession();
+    testBatchCalibration();
     testCanadianZeroYieldFit();
     std::cout << "All Nelson-Siegel tests are over." << std::endl;
     return 0;
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <random>
+#include <cstring>
+#include "../include/cpp-quant/tools/optionchain.hpp"
+
+bool isClose(double a, double b, double tol) {return std::abs(a - b) <= tol;}
+
+std::vector<OptionChain::RawQuote> getQuotes(std::size_t n, std::vector<double>& volatilities)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> moneyness(.6, 1.5), maturity(.02, 5.0), volatility(.05, .8), rate(-.01, .06);
+    std::vector<OptionChain::RawQuote> quotes;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double S = 100, K = S*moneyness(generator), T = maturity(generator), sigma = volatility(generator), r = rate(generator), q = .01;
+        const double F = S*exp((r - q)*T), D = exp(-r*T);
+        const bool isCall = K >= F;
+        const double price = D*sqrt(F*K)*UndiscountedBlack::getPrice(log(F/K), sigma*sqrt(T), isCall);
+        quotes.push_back(OptionChain::RawQuote(price, S, K, T, r, q, isCall));
+        volatilities.push_back(sigma);
+    }
+    return quotes;
+}
+
+void testOptionChainPipeline()
+{
+    std::vector<double> volatilities;
+    std::vector<OptionChain::RawQuote> quotes = getQuotes(20000, volatilities);
+    // Failures are reported per quote
+    quotes[3].price_ = -1.0; quotes[5].strike_ = NAN; quotes[7].price_ = 0.0; quotes[9].price_ = 1e6;
+
+    OptionChain::Pipeline pipeline = OptionChain::Pipeline(1);
+    pipeline.setChunkSize(64);
+    const std::vector<OptionChain::Result> reference = pipeline.process(quotes);
+    assert(reference[3].status_ == OptionChain::QuoteStatus::INVALID_INPUT);
+    assert(reference[5].status_ == OptionChain::QuoteStatus::INVALID_INPUT);
+    assert(reference[7].status_ == OptionChain::QuoteStatus::NO_TIME_VALUE);
+    assert(reference[9].status_ == OptionChain::QuoteStatus::ABOVE_UPPER_BOUND);
+    assert(std::isnan(reference[9].impliedVolatility_) and std::isnan(reference[9].greeks_.vega_));
+    for (std::size_t i = 0; i < quotes.size(); ++i)
+    {
+        if (i == 3 or i == 5 or i == 7 or i == 9) continue;
+        const OptionChain::Result& r = reference[i];
+        assert(r.status_ == OptionChain::QuoteStatus::OK);
+        assert(isClose(r.impliedVolatility_, volatilities[i], 1e-6*volatilities[i]));
+        const OptionChain::RawQuote& q = quotes[i];
+        const UndiscountedBlack::Greeks g = UndiscountedBlack::getGreeks(r.forward_, q.strike_, q.maturity_, r.impliedVolatility_, q.isCall_);
+        assert(g.vega_ == r.greeks_.vega_ and g.delta_ == r.greeks_.delta_);
+        assert(isClose(r.discountFactor_*r.greeks_.price_, q.price_, 1e-10*q.spot_));
+    }
+
+    // Output does not depend on the number of workers nor on who processed which chunk
+    for (std::size_t threads: {2, 3, 8})
+    {
+        OptionChain::Pipeline parallelPipeline = OptionChain::Pipeline(threads);
+        parallelPipeline.setChunkSize(64);
+        const std::vector<OptionChain::Result> results = parallelPipeline.process(quotes);
+        assert(results.size() == reference.size());
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            assert(results[i].status_ == reference[i].status_);
+            assert(std::memcmp(&results[i].impliedVolatility_, &reference[i].impliedVolatility_, sizeof(double)) == 0);
+            assert(std::memcmp(&results[i].greeks_, &reference[i].greeks_, sizeof(UndiscountedBlack::Greeks)) == 0);
+        }
+    }
+    assert(OptionChain::Pipeline(4).process(std::vector<OptionChain::RawQuote>()).empty());
+    std::cout << "Option chain pipeline Passed!" << std::endl;
+}
+
+int main()
+{
+    testOptionChainPipeline();
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include "../include/cpp-quant/tools/threadpool.hpp"
+
+void testThreadPoolRun()
+{
+    ThreadPool& pool = ThreadPool::getInstance();
+    assert(&pool == &ThreadPool::getInstance());
+    for (std::size_t workers : {0ul, 1ul, 2ul, pool.getThreads() + 1, 4*pool.getThreads() + 3})
+    {
+        std::vector<int> calls(workers, 0);
+        pool.run(workers, [&calls](std::size_t w) {calls[w]++;});
+        for (int count : calls) assert(count == 1);
+    }
+}
+
+void testThreadPoolNested()
+{
+    // Runs issued from workers complete on their caller whatever the pool occupancy
+    ThreadPool& pool = ThreadPool::getInstance();
+    std::atomic<std::size_t> total(0);
+    pool.run(8, [&pool, &total](std::size_t) {
+        pool.run(8, [&total](std::size_t w) {total += w;});
+    });
+    assert(total == 8*28);
+}
+
+void testThreadPoolException()
+{
+    ThreadPool& pool = ThreadPool::getInstance();
+    std::atomic<std::size_t> done(0);
+    bool thrown = false;
+    try
+    {
+        pool.run(16, [&done](std::size_t w) {
+            done++;
+            if (w % 5 == 3) throw std::runtime_error("worker");
+        });
+    }
+    catch (const std::runtime_error&) {thrown = true;}
+    // Every worker ran before the exception was rethrown, the pool stays usable
+    assert(thrown and done == 16);
+    std::atomic<std::size_t> after(0);
+    pool.run(16, [&after](std::size_t) {after++;});
+    assert(after == 16);
+}
+
+int main()
+{
+    testThreadPoolRun();
+    testThreadPoolNested();
+    testThreadPoolException();
+    return 0;
+}
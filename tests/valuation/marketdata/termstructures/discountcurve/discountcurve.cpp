@@ -194,6 +194,27 @@ void testErrors()
 
 }
 
+void testGetValues()
+{
+    // Inside the pillars, on the last one and beyond 30Y where the curve extrapolates with its Svensson fit
+    std::vector<double> times = {0.0, .1, .25, 1.0, 2.5, 7.0, 10.0, 30.0, 31.0, 45.0, 80.0, 120.0, 5.0};
+    DiscountCurve cubic(CanadianZeroYieldData::REFERENCE_DATE, CanadianZeroYieldData::getData(), DiscountCurve::InterpolationMethod::CUBIC_SPLINE, CanadianZeroYieldData::interpolationVariable);
+    DiscountCurve svensson = cubic.getSvenssonCurve();
+    for (const DiscountCurve* curve: {&cubic, &svensson})
+    {
+        std::vector<double> values = curve->getValues(times);
+        assert(values.size() == times.size());
+        for (std::size_t k = 0; k < times.size(); ++k)
+        {
+            const double value = curve->getValue(times[k]);
+            assert((std::isnan(value) and std::isnan(values[k])) or std::fabs(values[k] - value) <= 1e-14);
+        }
+    }
+    assert(cubic.getValues({}).empty());
+    try{cubic.getValues({1.0, -1.0}); assert(false);}
+    catch(const QuantErrorRegistry::NegativeYearFractionError& e){assert(true);}
+}
+
 void testNelsonSiegelCurve()
 {
     DiscountCurve canadianCubic(CanadianZeroYieldData::REFERENCE_DATE, CanadianZeroYieldData::getData(), DiscountCurve::InterpolationMethod::CUBIC_SPLINE, CanadianZeroYieldData::interpolationVariable);
@@ -216,6 +237,7 @@ int main()
 {
     testConstructors(); 
     testErrors(); 
+    testGetValues();
     testNelsonSiegelCurve();
     std::cout << "All tests for the discount curve has been passed successfully!" << std::endl;
     return 0; 
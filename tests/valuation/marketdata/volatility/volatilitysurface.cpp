@@ -0,0 +1,93 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include "../../../../include/cpp-quant/valuation/marketdata/volatility/volatilitysurface.hpp"
+
+const DateTime REFERENCE_DATE = DateTime(1758704936, EpochTimestampType::SECONDS);
+
+bool isClose(double a, double b, double tol) {return std::abs(a - b) <= tol;}
+
+std::vector<VolatilitySurface::Quote> getQuotes(const std::vector<double>& maturities, const std::vector<double>& forwards, const std::vector<VolatilitySurface::Slice>& slices)
+{
+    std::vector<VolatilitySurface::Quote> quotes;
+    for (std::size_t i = 0; i < maturities.size(); ++i)
+    {
+        for (double k = -.6; k <= .4001; k += .05)
+        {
+            const double K = forwards[i]*std::exp(k*std::sqrt(maturities[i]));
+            const double w = slices[i].getTotalVariance(std::log(K/forwards[i]));
+            quotes.push_back(VolatilitySurface::Quote(forwards[i], K, maturities[i], std::sqrt(w/maturities[i])));
+        }
+    }
+    return quotes;
+}
+
+void testSVISurface()
+{
+    const std::vector<double> maturities = {.25, 1.0, 2.0}, forwards = {100.5, 102.0, 104.1};
+    const std::vector<VolatilitySurface::Slice> slices = {{.008, .08, -.5, .02, .15}, {.03, .12, -.45, .05, .25}, {.07, .14, -.4, .08, .3}};
+    const std::vector<VolatilitySurface::Quote> quotes = getQuotes(maturities, forwards, slices);
+    VolatilitySurface surface = VolatilitySurface(REFERENCE_DATE, quotes, VolatilitySurface::Parametrization::SVI);
+
+    assert(surface.getRootMeanSquaredError() < 1e-5);
+    assert(surface.getArbitrageReport().isArbitrageFree_);
+    for (const auto& q: quotes) assert(isClose(surface.getVolatility(q.strike_, q.maturity_), q.volatility_, 5e-5));
+
+    // Linear total variance at fixed log-moneyness between expiries, flat volatility outside
+    const double k = -.1, T = .5, alpha = (T - .25)/.75;
+    const double w = (1 - alpha)*slices[0].getTotalVariance(k) + alpha*slices[1].getTotalVariance(k);
+    assert(isClose(surface.getTotalVariance(k, T), w, 1e-5));
+    assert(isClose(surface.getForward(T), std::exp((1 - alpha)*std::log(100.5) + alpha*std::log(102.0)), 1e-12));
+    assert(isClose(surface.getVolatility(104.1, 5.0), surface.getVolatility(104.1, 2.0), 1e-14));
+
+    // Grid queries agree with the scalar path
+    const std::vector<double> strikes = {70, 90, 100, 110, 130}, times = {0.0, .1, .25, .7, 1.5, 3.0};
+    const std::vector<double> grid = surface.getVolatilities(strikes, times);
+    for (std::size_t i = 0; i < times.size(); ++i)
+        for (std::size_t j = 0; j < strikes.size(); ++j) assert(grid[i*strikes.size() + j] == surface.getVolatility(strikes[j], times[i]));
+    std::cout << "SVI volatility surface Passed! (RMSE " << surface.getRootMeanSquaredError() << ")" << std::endl;
+}
+
+void testSSVISurface()
+{
+    const VolatilitySurface::SSVIParameters parameters = {-.4, 1.1, .4};
+    const std::vector<double> maturities = {.1, .5, 1.0, 3.0}, forwards = {100, 100, 100, 100}, thetas = {.004, .018, .035, .11};
+    std::vector<VolatilitySurface::Slice> slices;
+    for (double theta: thetas)
+    {
+        const double phi = parameters.eta_/(std::pow(theta, parameters.gamma_)*std::pow(1 + theta, 1 - parameters.gamma_)), rho = parameters.rho_;
+        slices.push_back({.5*theta*(1 - rho*rho), .5*theta*phi, rho, -rho/phi, std::sqrt(1 - rho*rho)/phi});
+    }
+    VolatilitySurface surface = VolatilitySurface(REFERENCE_DATE, getQuotes(maturities, forwards, slices), VolatilitySurface::Parametrization::SSVI);
+    assert(isClose(surface.getSSVIParameters().rho_, parameters.rho_, 1e-4));
+    assert(isClose(surface.getSSVIParameters().eta_, parameters.eta_, 1e-4));
+    assert(isClose(surface.getSSVIParameters().gamma_, parameters.gamma_, 1e-4));
+    assert(surface.getRootMeanSquaredError() < 1e-6);
+    assert(surface.getArbitrageReport().isArbitrageFree_);
+    std::cout << "SSVI volatility surface Passed!" << std::endl;
+}
+
+void testArbitrageReport()
+{
+    // Second slice below the first one at every strike
+    const std::vector<double> maturities = {.5, 1.0}, forwards = {100, 100};
+    const std::vector<VolatilitySurface::Slice> slices = {{.04, .1, -.3, 0.0, .2}, {.01, .1, -.3, 0.0, .2}};
+    VolatilitySurface surface = VolatilitySurface(REFERENCE_DATE, getQuotes(maturities, forwards, slices), VolatilitySurface::Parametrization::SVI);
+    assert(!surface.getArbitrageReport().isArbitrageFree_);
+    assert(surface.getArbitrageReport().calendarViolations_ > 0);
+    assert(surface.getArbitrageReport().worstCalendarSpread_ < 0);
+
+    bool hasThrown = false;
+    try {VolatilitySurface(REFERENCE_DATE, {}, VolatilitySurface::Parametrization::SVI);}
+    catch (const QuantErrorRegistry::Valuation::MarketData::VolatilitySurface::EmptyVolatilityQuotesError&) {hasThrown = true;}
+    assert(hasThrown);
+    std::cout << "Volatility surface arbitrage report Passed!" << std::endl;
+}
+
+int main()
+{
+    testSVISurface();
+    testSSVISurface();
+    testArbitrageReport();
+    return 0;
+}